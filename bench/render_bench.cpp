@@ -0,0 +1,96 @@
+/* Measure the per-eye cost of putting a swapped 1920x1080 video frame on a 3D canvas,
+   the chain of cv::cvtColor and cv::resize into the canvas against the fused
+   resizeConvert() with each kernel the CPU runs, for the usual window geometries.
+   Usage: render_bench [iterations (200 for default)] */
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include "define/resize_convert.h"
+
+namespace {
+
+    const int WIDTH = 1920;
+    const int HEIGHT = 1080;
+
+    template<typename Func>
+    double measure(int iterations, Func func)
+    {
+        func(); // warm up the caches and the lazily allocated buffers
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++) {
+            func();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    }
+
+    // The eye region of a canvas, letterboxed like VisionViewer::updateRenderPlan()
+    void benchGeometry(int iterations, const cv::Mat& eye, int win_width, int win_height,
+                       bool is_hcompress)
+    {
+        double scale = std::min(1. * win_width / eye.cols, 1. * win_height / eye.rows);
+        cv::Size dst_size(cvRound(eye.cols * scale), cvRound(eye.rows * scale));
+        int half_width = win_width;
+        if(is_hcompress) {
+            half_width = win_width / 2;
+            dst_size.width /= 2;
+        }
+        cv::Mat canvas(win_height, half_width * 2, CV_8UC3, cv::Scalar::all(0));
+        cv::Mat dst = canvas(cv::Rect((half_width - dst_size.width) / 2,
+                                      (win_height - dst_size.height) / 2,
+                                      dst_size.width, dst_size.height));
+        printf("  %dx%d%s, eye at %dx%d\n", win_width, win_height,
+               is_hcompress ? " h-compressed" : "", dst_size.width, dst_size.height);
+
+        cv::Mat swapped, expected;
+        double ms = measure(iterations, [&]() {
+            cv::cvtColor(eye, swapped, cv::COLOR_BGR2RGB);
+            cv::resize(swapped, dst, dst_size, 0, 0, cv::INTER_LINEAR);
+        });
+        dst.copyTo(expected);
+        printf("    cvtColor + resize     : %6.2f ms/eye\n", ms);
+
+        // Planned once like a render plan, so only the per-frame work is measured
+        ResizeConvertPlan plan;
+        plan.update(eye.size(), dst_size);
+        for(int k = RESIZE_KERNEL_SCALAR; k < RESIZE_KERNEL_NUM; k++) {
+            ResizeKernel kernel = static_cast<ResizeKernel>(k);
+            if(!isResizeKernelSupported(kernel)) {
+                continue;
+            }
+            dst.setTo(cv::Scalar::all(0));
+            ms = measure(iterations, [&]() {
+                resizeConvert(eye, dst, true, plan, kernel);
+            });
+            double diff = cv::norm(dst, expected, cv::NORM_INF);
+            printf("    resizeConvert %-8s: %6.2f ms/eye, max difference %.0f%s\n",
+                   getResizeKernelName(kernel), ms, diff, diff > 2 ? " MISMATCH" : "");
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+
+    // A smooth gradient with some detail, the eye of a side-by-side video
+    cv::Mat eye(HEIGHT, WIDTH, CV_8UC3);
+    for(int y = 0; y < HEIGHT; y++) {
+        uchar* row = eye.ptr(y);
+        for(int x = 0; x < WIDTH; x++) {
+            row[3*x]     = (uchar)(x * 255 / WIDTH);
+            row[3*x + 1] = (uchar)(y * 255 / HEIGHT);
+            row[3*x + 2] = (uchar)((x ^ y) & 0xFF);
+        }
+    }
+
+    printf("render_bench: %dx%d eye, %d iterations, [%s] kernel by default.\n",
+           WIDTH, HEIGHT, iterations, getResizeKernelName(RESIZE_KERNEL_AUTO));
+    benchGeometry(iterations, eye, 1920, 1080, false);
+    benchGeometry(iterations, eye, 1920, 1080, true);
+    benchGeometry(iterations, eye, 1280, 720, false);
+    benchGeometry(iterations, eye, 2560, 1440, false);
+    return 0;
+}
@@ -21,8 +21,14 @@ int main(int argc, char* argv[])
            "  optional_args: \n"
            "\t\t -w [width]\tSpecified the image width, default 1920.\n"
            "\t\t -h [width]\tSpecified the image height, default 1080.\n"
+           "\t\t -s [source]\tSpecified the capture source: opencv (default), v4l2 or synthetic.\n"
+           "\t\t -d [prefix]\tReplay the capture dumps [prefix]_0/1.v4ldump of endo_viewer, 0 for the left eye.\n"
+           "\t\t -x\tReplay at maximum speed instead of the recorded timing.\n"
+           "\t\t -l\tLow latency, only the newest frame is kept and older ones are skipped.\n"
+           "\t\t -q [policy]\tWhen the recording lags: block (default), oldest or newest to drop.\n"
            );
     printScreenArgDesc();
+    printThreadArgDesc();
     printf("-------------------------------------------------------------------------\n");
     printf("                         CameraViewer Startup \n");
     printf("-------------------------------------------------------------------------\n");
@@ -56,7 +62,7 @@ int main(int argc, char* argv[])
     option.imheight = 1080;
 
     int opt;
-    std::string optstring = "w:h:n:";
+    std::string optstring = "w:h:s:d:xln:a:q:";
     while((opt = getopt(argc, argv, optstring.c_str())) != -1) {
         switch (opt)
         {
@@ -68,6 +74,27 @@ int main(int argc, char* argv[])
             option.imheight = std::stoi(optarg);
             printf("CameraViewer: specify image height to %d.\n", option.imheight);
             break;  
+        case 's':
+            if(!parseCameraBackend(optarg, option.backend)) {
+                std::ostringstream err;
+                err << "CameraViewer: invalid capture source is given: " << optarg << std::endl;
+                throw std::invalid_argument(err.str());
+            }
+            printf("CameraViewer: specify capture source to %s.\n", optarg);
+            break;
+        case 'd':
+            option.backend = CAMERA_REPLAY;
+            option.replay_prefix = optarg;
+            printf("CameraViewer: replay the capture dumps %s_0/1.v4ldump.\n", optarg);
+            break;
+        case 'x':
+            option.is_replay_realtime = false;
+            printf("CameraViewer: replay at maximum speed.\n");
+            break;
+        case 'l':
+            option.is_latest_only = true;
+            printf("CameraViewer: only the newest frames are kept.\n");
+            break;
         case 'n':
             if(!parseScreenInfo(optarg, option.screens)) {
                 std::ostringstream err;
@@ -75,6 +102,21 @@ int main(int argc, char* argv[])
                 throw std::invalid_argument(err.str());
             }
             break;
+        case 'q':
+            if(!parseRecordPolicy(optarg, option.record_policy)) {
+                std::ostringstream err;
+                err << "CameraViewer: invalid record policy is given: " << optarg << std::endl;
+                throw std::invalid_argument(err.str());
+            }
+            printf("CameraViewer: specify record policy to %s.\n", optarg);
+            break;
+        case 'a':
+            if(!parseThreadConfig(optarg, option.threads)) {
+                std::ostringstream err;
+                err << "CameraViewer: invalid thread config is given: " << optarg << std::endl;
+                throw std::invalid_argument(err.str());
+            }
+            break;
         default:
             break;
         }
@@ -0,0 +1,144 @@
+/* Measure the per-frame cost of turning one 1920x1080 camera frame into RGB, for the
+   MJPEG and the raw YUYV capture modes. Given a capture dump of endo_viewer (-d), every
+   recorded buffer is also decoded through V4L2Capture, as the cameras delivered them.
+   Usage: endo_bench [iterations (200 for default)] [capture_dump] */
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <turbojpeg.h>
+#include "inc/jpeg_decoder.h"
+#include "inc/yuv_convert.h"
+#include "inc/v4l2_capture.h"
+#include "inc/capture_dump.h"
+
+namespace {
+
+    const int WIDTH = 1920;
+    const int HEIGHT = 1080;
+
+    template<typename Func>
+    double measure(int iterations, Func func)
+    {
+        func(); // warm up the caches and the lazily allocated buffers
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++) {
+            func();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    }
+
+    // Decode all buffers of a capture dump at maximum speed
+    bool benchDump(const std::string& path)
+    {
+        CaptureDumpReader reader;
+        if(!reader.open(path))
+            return false;
+        const auto& format = reader.getFormat();
+        V4L2Capture capture(format.width, format.height);
+        capture.openReplay(format.pixel_format, format.bytes_per_line);
+
+        // Read everything first, so that the disk is not measured
+        std::vector<CaptureDumpFrame> frames(reader.getFrameCount());
+        for(unsigned int i = 0; i < frames.size(); i++) {
+            if(!reader.read(i, frames[i])) {
+                frames.resize(i);
+                break;
+            }
+        }
+        if(frames.empty())
+            return false;
+
+        cv::Mat out(format.height, format.width, CV_8UC3);
+        unsigned int failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const auto& frame : frames) {
+            if(!capture.decodePayload(frame.payload.data(), frame.payload.size(), out.data, out.step))
+                failed++;
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        double recorded_ms = (frames.back().timestamp_us - frames.front().timestamp_us) / 1000.;
+        printf("  Dump   %s: %lu frames of %ux%u, %u corrupt\n", path.c_str(), frames.size(),
+               format.width, format.height, failed);
+        printf("         decode %6.2f ms/frame, %.0f FPS, recorded at %.1f FPS\n",
+               ms / frames.size(), frames.size() * 1000. / ms,
+               recorded_ms > 0 ? (frames.size() - 1) * 1000. / recorded_ms : 0.);
+        return true;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+
+    // A smooth gradient with some detail, compressed the way a UVC camera does (4:2:2)
+    cv::Mat rgb(HEIGHT, WIDTH, CV_8UC3);
+    for(int y = 0; y < HEIGHT; y++) {
+        uchar* row = rgb.ptr(y);
+        for(int x = 0; x < WIDTH; x++) {
+            row[3*x]     = (uchar)(x * 255 / WIDTH);
+            row[3*x + 1] = (uchar)(y * 255 / HEIGHT);
+            row[3*x + 2] = (uchar)((x ^ y) & 0xFF);
+        }
+    }
+
+    tjhandle encoder = tjInitCompress();
+    unsigned char* jpeg = nullptr;
+    unsigned long jpeg_size = 0;
+    if(tjCompress2(encoder, rgb.data, WIDTH, rgb.step, HEIGHT, TJPF_RGB, 
+                   &jpeg, &jpeg_size, TJSAMP_422, 85, TJFLAG_FASTDCT) != 0) {
+        printf("endo_bench: cannot encode the test frame, %s\n", tjGetErrorStr2(encoder));
+        tjDestroy(encoder);
+        return -1;
+    }
+    tjDestroy(encoder);
+
+    // The same kind of picture as packed YUYV, U and V are shared by two pixels
+    cv::Mat yuyv(HEIGHT, WIDTH, CV_8UC2);
+    for(int y = 0; y < HEIGHT; y++) {
+        uchar* row = yuyv.ptr(y);
+        for(int x = 0; x < WIDTH; x += 2) {
+            row[2*x]     = (uchar)(16 + x * 219 / WIDTH);
+            row[2*x + 1] = (uchar)(16 + y * 224 / HEIGHT);
+            row[2*x + 2] = (uchar)(16 + (x + 1) * 219 / WIDTH);
+            row[2*x + 3] = (uchar)(16 + ((x ^ y) & 0xFF) * 224 / 256);
+        }
+    }
+
+    cv::Mat out(HEIGHT, WIDTH, CV_8UC3);
+    JpegDecoder decoder;
+    printf("endo_bench: %dx%d, %d iterations, MJPEG frame of %lu bytes.\n", 
+           WIDTH, HEIGHT, iterations, jpeg_size);
+
+    double ms = measure(iterations, [&]() {
+        decoder.decode(jpeg, jpeg_size, out.data, WIDTH, out.step, HEIGHT);
+    });
+    printf("  MJPEG  JpegDecoder          : %6.2f ms/frame\n", ms);
+
+    ms = measure(iterations, [&]() {
+        decoder.decode(jpeg, jpeg_size, out.data, WIDTH, out.step, HEIGHT, 2);
+    });
+    printf("  MJPEG  JpegDecoder 1/2 scale: %6.2f ms/frame\n", ms);
+
+    ms = measure(iterations, [&]() {
+        yuyv2rgb(yuyv.data, yuyv.step, out.data, out.step, WIDTH, HEIGHT);
+    });
+    printf("  YUYV   yuyv2rgb             : %6.2f ms/frame\n", ms);
+
+    ms = measure(iterations, [&]() {
+        cv::cvtColor(yuyv, out, cv::COLOR_YUV2RGB_YUYV);
+    });
+    printf("  YUYV   cv::cvtColor         : %6.2f ms/frame\n", ms);
+
+    tjFree(jpeg);
+
+    if(argc > 2 && !benchDump(argv[2])) {
+        printf("endo_bench: cannot replay %s\n", argv[2]);
+        return -1;
+    }
+    return 0;
+}
@@ -1,14 +1,94 @@
 #include <cstdio>
 #include <string>
+#include <unistd.h>
 #include "./src/endo_viewer.h"
 
 int main(int argc, char* argv[]) 
 {
     printf("================ Endoscope viewer startup ================\n"
            "Command line usage:\n"
-           "\t endo_viewer [left_cam_id (0 for default)] [right_cam_id (1 for default)]\n");
+           "\t endo_viewer [left_cam_id (0 for default)] [right_cam_id (1 for default)] "
+           "[write_video (0 for default)] [optional_args]\n"
+           "  optional_args: \n"
+           "\t\t -t [value]\tPair the left and right frames within [value] ms, 8 for default\n"
+           "\t\t -r\tCapture raw YUYV/NV12 frames instead of MJPEG\n"
+           "\t\t -m\tRecord the camera MJPEG frames as they are, one AVI per eye\n"
+           "\t\t -d [prefix]\tDump the captured buffers to [prefix]_0/1.v4ldump for replay\n"
+           "\t\t -l\tLow latency, only the newest frame is decoded and older ones are skipped\n"
+           "\t\t -s [width]x[height]\tThe requested frame size, 1920x1080 for default\n"
+           "\t\t -p [policy]\tThe camera mode, 'fps' for the highest fps at or above the requested\n"
+           "\t\t\t\tsize (default), 'latency' for the shortest frame interval of any size, or\n"
+           "\t\t\t\t'fixed' for the requested size at 60 fps\n");
+    printThreadArgDesc();
 
-    if(argc == 2) {
+    EndoViewerOption option;
+    int opt;
+    std::string optstring = "t:rmd:ls:p:a:";
+    while((opt = getopt(argc, argv, optstring.c_str())) != -1) {
+        switch (opt)
+        {
+        case 't':
+            option.pair_tolerance_us = std::stoi(optarg) * 1000;
+            printf("Left and right frames are paired within %s ms.\n", optarg);
+            break;
+        case 'r':
+            option.is_raw = true;
+            printf("Raw YUYV/NV12 frames are captured.\n");
+            break;
+        case 'm':
+            option.is_passthrough = true;
+            printf("The camera MJPEG frames are recorded without re-encoding.\n");
+            break;
+        case 'd':
+            option.dump_prefix = optarg;
+            printf("The captured buffers are dumped to %s_0/1.v4ldump.\n", optarg);
+            break;
+        case 'l':
+            option.is_latest_only = true;
+            printf("Only the newest frames are decoded.\n");
+            break;
+        case 's': {
+            int width = 0, height = 0;
+            if(sscanf(optarg, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                printf("ERROR: Invalid frame size %s.\n", optarg);
+                return -1;
+            }
+            option.width = width;
+            option.height = height;
+            printf("The requested frame size is %dx%d.\n", width, height);
+            break;
+        }
+        case 'p':
+            if(std::string(optarg) == "fps") {
+                option.mode_policy = V4L2Capture::MODE_MAX_FPS;
+            }
+            else if(std::string(optarg) == "latency") {
+                option.mode_policy = V4L2Capture::MODE_MIN_LATENCY;
+            }
+            else if(std::string(optarg) == "fixed") {
+                option.mode_policy = V4L2Capture::MODE_REQUESTED;
+            }
+            else {
+                printf("ERROR: Unknown mode policy %s.\n", optarg);
+                return -1;
+            }
+            printf("The camera mode is chosen by '%s'.\n", optarg);
+            break;
+        case 'a':
+            if(!parseThreadConfig(optarg, option.threads)) {
+                printf("ERROR: Invalid thread config %s.\n", optarg);
+                return -1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // The positional arguments are moved behind the options by getopt
+    int nargs = argc - optind;
+    char** args = argv + optind;
+    if(nargs == 1) {
         printf("ERROR: Please specified another cam index.\n");
         return -1;
     }
@@ -16,20 +96,16 @@ int main(int argc, char* argv[])
     uint8_t left_cam_id = 0;
     uint8_t right_cam_id = 1;
     bool is_write_video = false;
-    if(argc == 3) {
-        left_cam_id = std::stoi(argv[1]);
-        right_cam_id = std::stoi(argv[2]);
+    if(nargs >= 2) {
+        left_cam_id = std::stoi(args[0]);
+        right_cam_id = std::stoi(args[1]);
     }
-    if(argc == 4) {
-        left_cam_id = std::stoi(argv[1]);
-        right_cam_id = std::stoi(argv[2]);
-        is_write_video = std::stoi(argv[3]);
+    if(nargs >= 3) {
+        is_write_video = std::stoi(args[2]);
     }
 
-    EndoViewer endo_viewer;
+    EndoViewer endo_viewer(option);
     endo_viewer.startup(left_cam_id, right_cam_id, is_write_video);
 
     return 0;
 }
-
-
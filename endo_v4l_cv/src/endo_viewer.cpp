@@ -1,6 +1,13 @@
 #include "endo_viewer.h"
 #include <ctime>
+#include <cmath>
 #include "./inc/v4l2_capture.h"
+#include "./inc/capture_engine.h"
+#include "./inc/decode_pool.h"
+#include "./inc/jpeg_decoder.h"
+#include "./inc/avi_mjpeg_writer.h"
+#include "./inc/capture_dump.h"
+#include "../../src/define/frame_clock.h"
 
 #define DO_EFFECIENCY_TEST 1
 
@@ -27,20 +34,64 @@ namespace {
         return std::string(tmp);
     }
 
-    const uint8_t TIME_INTTERVAL = 17;
+    // cv::imshow, cv::imwrite and cv::VideoWriter all take BGR, so the frames are decoded
+    // in that order once and never swapped afterwards
+    const bool IS_BGR = true;
+
+    // About half a second of both cameras, more means the disk cannot keep up
+    const size_t MAX_RECORD_QUEUE = 64;
+}
+
+
+EndoViewerOption::EndoViewerOption()
+    : pair_tolerance_us(8000)
+    , is_raw(false)
+    , is_passthrough(false)
+    , dump_prefix("")
+    , is_latest_only(false)
+    , width(1920), height(1080)
+    , mode_policy(V4L2Capture::MODE_MAX_FPS) {
 }
 
 
-EndoViewer::EndoViewer() 
-    : imwidth(1920), imheight(1080)
-    , _image_l(cv::Mat(imheight, imwidth, CV_8UC3))
-    , _image_r(cv::Mat(imheight, imwidth, CV_8UC3))
+EndoViewer::EndoViewer(const EndoViewerOption& option) 
+    : imwidth(option.width), imheight(option.height)
+    , _option(option)
+    , _should_stop(false)
+    , _cap_l(nullptr), _cap_r(nullptr), _engine(nullptr), _decode_pool(nullptr)
+    , _dumps{nullptr, nullptr}
+    , _pairer(option.pair_tolerance_us)
+    , _view_width(option.width), _view_height(option.height)
+    , _snapshot_pending(false)
+    , _capture_fps(0)
     , _is_write_to_video(false)
+    , _should_stop_writer(false)
+    , _record_dropped(0)
 {
 }
 
 
 EndoViewer::~EndoViewer() {
+    // The bring-up may still be retrying the cameras, nothing is freed before it is over
+    _should_stop = true;
+    if(_thread_capture.joinable()) {
+        _thread_capture.join();
+    }
+    // No frame is queued once the capture is down, the writer then finishes its files
+    delete _engine;
+    {
+        // Set under the lock, or the writer could miss the wakeup
+        std::lock_guard<std::mutex> lock(_record_mutex);
+        _should_stop_writer = true;
+    }
+    _record_cond.notify_all();
+    if(_thread_writer.joinable()) {
+        _thread_writer.join();
+    }
+    delete _decode_pool;
+    // The index of a dump is written on close
+    delete _dumps[0];
+    delete _dumps[1];
     delete _cap_l;
     delete _cap_r;
     cv::destroyAllWindows();
@@ -49,80 +100,217 @@ EndoViewer::~EndoViewer() {
 
 void EndoViewer::startup(uint8_t left_cam_id, uint8_t right_cam_id, bool is_write_to_video) {
     _is_write_to_video = is_write_to_video;
-    if(_is_write_to_video) {
-        _thread_writer = std::thread(&EndoViewer::writeVideo, this);
-        _thread_writer.detach();
+    if(_option.is_passthrough && _option.is_raw) {
+        printf("EndoViewer: raw frames have no MJPEG payload, they are encoded for recording.\n");
+        _option.is_passthrough = false;
     }
-
-    _thread_read_l = std::thread(&EndoViewer::readLeftImage, this, left_cam_id);
-    _thread_read_l.detach();
-    _thread_read_r = std::thread(&EndoViewer::readRightImage, this, right_cam_id);
-    _thread_read_r.detach();
+    _thread_capture = std::thread(&EndoViewer::startCapture, this, left_cam_id, right_cam_id);
 
     show();
 }
 
 
-void EndoViewer::readLeftImage(int index) {
-    _cap_l = new V4L2Capture(imwidth, imheight, 3);
-    while(!_cap_l->openDevice(index)) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        printf("Camera %d is retrying to connection!!!\n", index);
+void EndoViewer::startCapture(uint8_t left_cam_id, uint8_t right_cam_id) {
+    auto mode = _option.is_raw ? V4L2Capture::STREAM_RAW : V4L2Capture::STREAM_MJPEG;
+    _cap_l = new V4L2Capture(_option.width, _option.height, 3, mode, IS_BGR);
+    _cap_r = new V4L2Capture(_option.width, _option.height, 3, mode, IS_BGR);
+    _cap_l->setLatestOnly(_option.is_latest_only);
+    _cap_r->setLatestOnly(_option.is_latest_only);
+    _cap_l->setModePolicy(_option.mode_policy);
+    _cap_r->setModePolicy(_option.mode_policy);
+
+    // Bring both cameras up at the same time, the stream negotiation of a UVC camera takes
+    // tens of milliseconds that the other one should not wait for. The retry starts short
+    // since a camera still enumerating shows up soon after.
+    auto bring_up = [this](V4L2Capture* cap, uint8_t cam_id) {
+        int retry_ms = 50;
+        while(!_should_stop && !cap->openDevice(cam_id)) {
+            // Slept in short steps, so an exit is not held up by the backoff
+            for(int ms = 0; ms < retry_ms && !_should_stop; ms += 10) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            retry_ms = std::min(retry_ms * 2, 1000);
+            printf("Camera %d is retrying to connection!!!\n", cam_id);
+        }
+    };
+    auto time_start = ::getCurrentTimePoint();
+    std::thread thread_l(bring_up, _cap_l, left_cam_id);
+    std::thread thread_r(bring_up, _cap_r, right_cam_id);
+    thread_l.join();
+    thread_r.join();
+    if(_should_stop) {
+        return;
     }
+    printf("EndoViewer: both cameras are up in [%ld]ms (left %ld ms, right %ld ms).\n",
+           ::getDurationSince(time_start), _cap_l->getStartupMs(), _cap_r->getStartupMs());
+
+    // The eyes are paired and shown side by side, so both run the mode of the left one,
+    // its exact frame interval as well, or the pairing loses the frames of the faster eye
+    auto mode_l = _cap_l->getMode();
+    auto mode_r = _cap_r->getMode();
+    bool is_same_mode = mode_r.width == mode_l.width && mode_r.height == mode_l.height
+        && uint64_t(mode_r.interval_num) * mode_l.interval_den 
+           == uint64_t(mode_l.interval_num) * mode_r.interval_den;
+    if(!is_same_mode) {
+        printf("EndoViewer: the right camera runs %ux%u at %.2f fps, reopen it at %ux%u at "
+               "%.2f fps of the left one.\n", mode_r.width, mode_r.height, mode_r.getFPS(),
+               mode_l.width, mode_l.height, mode_l.getFPS());
+        delete _cap_r;
+        _cap_r = new V4L2Capture(mode_l.width, mode_l.height, 3, mode, IS_BGR);
+        _cap_r->setLatestOnly(_option.is_latest_only);
+        _cap_r->setMode(mode_l);
+        bring_up(_cap_r, right_cam_id);
+        if(_should_stop) {
+            return;
+        }
+        if(_cap_r->getWidth() != mode_l.width || _cap_r->getHeight() != mode_l.height
+           || std::fabs(_cap_r->getFPS() - _cap_l->getFPS()) > 0.01) {
+            printf("EndoViewer: WARNING, the right camera only runs %ux%u at %.2f fps, the "
+                   "eyes will not pair frame by frame.\n", _cap_r->getWidth(), 
+                   _cap_r->getHeight(), _cap_r->getFPS());
+        }
+    }
+    imwidth = _cap_l->getWidth();
+    imheight = _cap_l->getHeight();
+    _capture_fps = _cap_l->getFPS();
+    printf("EndoViewer: capture %dx%d at %.1f fps.\n", (int)imwidth, (int)imheight, _cap_l->getFPS());
 
-    bool flag = 0;
-    while(true) {
-        auto time_start = ::getCurrentTimePoint();
-
-        flag = _cap_l->ioctlDequeueBuffers(_image_l.data);
-        flag = flag && (!_image_l.empty());
-        if(!flag) {
-            printf("EndoViewer::readLeftImage: USB ID: %d, image empty: %d.\n",
-                    index, _image_l.empty());
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            continue;
+    // The recording is sized from the negotiated mode, so it starts only now. The
+    // destructor joins this thread before it touches the writer.
+    if(_is_write_to_video) {
+        if(_option.is_passthrough) {
+            _thread_writer = std::thread(&EndoViewer::writePassthrough, this);
         }
+        else {
+            _thread_writer = std::thread(&EndoViewer::writeVideo, this);
+        }
+    }
 
-        auto ms = getDurationSince(time_start);
-#if DO_EFFECIENCY_TEST
-        printf("EndoViewer::readLeftImage: [%ld]ms elapsed.\n", ms);
-#endif
-        if(ms < 17) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(TIME_INTTERVAL - ms));
+    if(!_option.dump_prefix.empty()) {
+        V4L2Capture* caps[2] = { _cap_l, _cap_r };
+        for(int i = 0; i < 2; i++) {
+            CaptureDumpFormat format;
+            format.pixel_format = caps[i]->getPixelFormat();
+            format.width = caps[i]->getWidth();
+            format.height = caps[i]->getHeight();
+            format.bytes_per_line = caps[i]->getBytesPerLine();
+            std::string path = _option.dump_prefix + "_" + std::to_string(i) + ".v4ldump";
+            _dumps[i] = new CaptureDumpWriter();
+            if(_dumps[i]->open(path, format)) {
+                printf("EndoViewer: dump the buffers of the %s camera to %s.\n", 
+                       i ? "right" : "left", path.c_str());
+            }
         }
     }
+
+    // Both cameras are serviced by one epoll loop, each frame is taken as soon as the
+    // driver has it and decoded on the worker pool, no pacing is required.
+    auto& threads = _option.threads;
+    _decode_pool = new DecodePool(2, IS_BGR, 0, 4, [&threads](unsigned int index) {
+        applyThreadConfig(threads, THREAD_DECODE, "decode-" + std::to_string(index));
+    });
+    using namespace std::placeholders;
+    _engine = new CaptureEngine(std::bind(&EndoViewer::readImage, this, _1, _2, _3));
+    _engine->setThreadInit([&threads]() {
+        applyThreadConfig(threads, THREAD_CAPTURE, "capture");
+    });
+    _engine->addDevice(_cap_l);
+    _engine->addDevice(_cap_r);
+    if(!_engine->start()) {
+        printf("EndoViewer: cannot start the capture engine.\n");
+    }
 }
 
 
-void EndoViewer::readRightImage(int index) {
-    _cap_r = new V4L2Capture(imwidth, imheight, 3);
-    while(!_cap_r->openDevice(index)) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        printf("Camera %d is retrying to connection!!!\n", index);
+void EndoViewer::readImage(size_t device, V4L2Capture& cap, const v4l2_buffer& vbuffer) {
+    bool is_right = device == 1;
+
+#if DO_EFFECIENCY_TEST
+    auto time_start = ::getCurrentTimePoint();
+#endif
+    if(_is_write_to_video && _option.is_passthrough) {
+        queueRecordFrame(is_right, cap, vbuffer);
+    }
+    if(_dumps[device]) {
+        _dumps[device]->write(cap.getBufferData(vbuffer), vbuffer.bytesused, vbuffer.sequence,
+                              V4L2Capture::getTimestampUs(vbuffer));
     }
 
-    bool flag = 0;
-    while(true) {
-        auto time_start = ::getCurrentTimePoint();
+    // Decode no larger than the displays need, unless the full resolution is to be saved.
+    // Raw frames are always converted at full size.
+    bool is_encode_full = _is_write_to_video && !_option.is_passthrough;
+    int scale = 1;
+    if(cap.isCompressed() && !is_encode_full && !_snapshot_pending) {
+        scale = JpegDecoder::chooseScale(imwidth, imheight, _view_width, _view_height);
+    }
 
-        flag = _cap_r->ioctlDequeueBuffers(_image_r.data);
-        flag = flag && (!_image_r.empty());
-        if(!flag) {
-            printf("EndoViewer::readRightImage: USB ID: %d, image empty: %d.\n",
-                    index, _image_r.empty());
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            continue;
+    EyeFrame frame;
+    frame.image = acquireImage(is_right);
+    frame.view = (*frame.image)(cv::Rect(0, 0, JpegDecoder::getScaledSize(imwidth, scale), 
+                                         JpegDecoder::getScaledSize(imheight, scale)));
+    frame.sequence = vbuffer.sequence;
+    frame.timestamp_us = V4L2Capture::getTimestampUs(vbuffer);
+
+    // A raw frame takes about as long to convert as to copy, so it is converted right
+    // from the mapped buffer.
+    if(!cap.isCompressed()) {
+        if(cap.decodeBuffer(vbuffer, frame.view.data, frame.image->step)) {
+            _pairer.push(is_right, frame);
         }
-
-        auto ms = getDurationSince(time_start);
+    }
+    else {
+        // The payload is copied, the buffer goes back to the driver once this returns.
+        // The frames of each eye reach the pairer in sequence order, a corrupt frame is
+        // just dropped.
+        StereoPairer& pairer = _pairer;
+        _decode_pool->submit(device, vbuffer.sequence, cap.getBufferData(vbuffer), vbuffer.bytesused,
+                             frame.view.data, imwidth, frame.image->step, imheight, scale,
+                             [&pairer, is_right, frame](bool success) {
+                                if(success) {
+                                    pairer.push(is_right, frame);
+                                }
+                             });
+    }
 #if DO_EFFECIENCY_TEST
-        printf("EndoViewer::readRightImage: [%ld]ms elapsed.\n", ms);
+    printf("EndoViewer::read%sImage: [%ld]ms elapsed.\n", 
+            is_right ? "Right" : "Left", getDurationSince(time_start));
 #endif
-        if(ms < 17) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(TIME_INTTERVAL - ms));
+}
+
+
+void EndoViewer::queueRecordFrame(bool is_right, V4L2Capture& cap, const v4l2_buffer& vbuffer) {
+    const uchar* payload = static_cast<const uchar*>(cap.getBufferData(vbuffer));
+
+    std::lock_guard<std::mutex> lock(_record_mutex);
+    if(_record_queue.size() >= MAX_RECORD_QUEUE) {
+        _record_dropped++;
+        return;
+    }
+    RecordFrame frame;
+    frame.is_right = is_right;
+    frame.sequence = vbuffer.sequence;
+    frame.timestamp_us = V4L2Capture::getTimestampUs(vbuffer);
+    if(!_record_buffers.empty()) {
+        frame.payload.swap(_record_buffers.back());
+        _record_buffers.pop_back();
+    }
+    frame.payload.assign(payload, payload + vbuffer.bytesused);
+    _record_queue.push_back(std::move(frame));
+    _record_cond.notify_one();
+}
+
+
+std::shared_ptr<cv::Mat> EndoViewer::acquireImage(bool is_right) {
+    auto& images = _images[is_right];
+    for(auto& image : images) {
+        if(image.use_count() == 1) {
+            return image;
         }
     }
-}   
+    // All images are still pending, published or displayed
+    images.push_back(std::make_shared<cv::Mat>(imheight, imwidth, CV_8UC3));
+    return images.back();
+}
 
 
 void EndoViewer::show() {
@@ -138,70 +326,213 @@ void EndoViewer::show() {
     cv::setWindowProperty(win_name2, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN);
 
     cv::Mat imleft, imright;
+    StereoPair pair;
     bool is_show_left = true;
+    bool has_shown = false;
+    uint32_t shown_sequence = 0;
+    // Each pair is presented at its kernel timestamp plus a fixed delay, so the cadence is
+    // the one of the cameras however long each decode takes
+    FrameClock clock;
+    applyThreadConfig(_option.threads, THREAD_DISPLAY, "display");
+    // The preemptions are reported once all the threads run for a while
+    auto time_report = ::getCurrentTimePoint();
+    bool is_reported = false;
     while(true) {
-        auto time_start = ::getCurrentTimePoint();
-
-        cv::cvtColor(_image_l, imleft, cv::COLOR_RGB2BGR);
-        cv::cvtColor(_image_r, imright, cv::COLOR_RGB2BGR);
-        cv::hconcat(imleft, imright, bino);
-        cv::imshow(win_name, bino); 
-        if(is_show_left) {
-            cv::imshow(win_name2, imleft);
+        if(!is_reported && getDurationSince(time_report) > 5000) {
+            printThreadReport();
+            is_reported = true;
         }
-        else {
-            cv::imshow(win_name2, imright);
+
+        // Only the frames captured at the same moment are shown together, the two eyes
+        // differ in size only while the decode scale is changing
+        bool is_new = _pairer.getNewest(pair)
+                      && (!has_shown || pair.eye[0].sequence != shown_sequence)
+                      && pair.eye[0].view.size() == pair.eye[1].view.size();
+        if(is_new) {
+            double fps = _capture_fps;
+            if(fps > 0 && clock.getFPS() != fps) {
+                clock.setFPS(fps);
+            }
+            clock.waitTimestamp(pair.eye[0].timestamp_us);
+
+            imleft = pair.eye[0].view;
+            imright = pair.eye[1].view;
+            cv::hconcat(imleft, imright, bino);
+            cv::imshow(win_name, bino); 
+            if(is_show_left) {
+                cv::imshow(win_name2, imleft);
+            }
+            else {
+                cv::imshow(win_name2, imright);
+            }
+
+            // The decode scale follows the largest eye area on screen
+            cv::Rect rect_bino = cv::getWindowImageRect(win_name);
+            cv::Rect rect_mono = cv::getWindowImageRect(win_name2);
+            int view_width = std::max(rect_bino.width / 2, rect_mono.width);
+            int view_height = std::max(rect_bino.height, rect_mono.height);
+            if(view_width > 0 && view_height > 0) {
+                _view_width = view_width;
+                _view_height = view_height;
+            }
+
+            if(_snapshot_pending && imleft.cols == imwidth) {
+                std::string prefix = getCurrentTimeStr();
+                cv::imwrite(prefix + ".bmp", bino);
+                printf("EndoViewer: save bino image %s done.\n", prefix.c_str());
+                _snapshot_pending = false;
+            }
+#if DO_EFFECIENCY_TEST
+            auto stats = _pairer.getStats();
+            printf("EndoViewer::showBino: pair skew [%ld]us, mean [%.0f]us, max [%ld]us, "
+                   "unmatched [%lu/%lu], lost [%lu/%lu].\n", (long)stats.last_skew_us,
+                   stats.mean_skew_us, (long)stats.max_skew_us, stats.unmatched[0],
+                   stats.unmatched[1], stats.lost[0], stats.lost[1]);
+#endif
+            has_shown = true;
+            shown_sequence = pair.eye[0].sequence;
         }
-        char key = cv::waitKey(10);
+
+        // Polled until the next pair, the clock keeps the cadence
+        char key = cv::waitKey(1);
         if(key == 'q') {
-            printf("EndoViewer: exit video showing.\n");
+            auto stats = _pairer.getStats();
+            printf("EndoViewer: exit video showing, [%lu] pairs shown, mean skew [%.0f]us, "
+                   "max skew [%ld]us, unmatched [%lu/%lu] frames.\n", stats.pairs,
+                   stats.mean_skew_us, (long)stats.max_skew_us, 
+                   stats.unmatched[0], stats.unmatched[1]);
+            if(_decode_pool) {
+                auto decode_stats = _decode_pool->getStats();
+                printf("EndoViewer: [%lu] frames decoded, [%lu] corrupt, [%lu] rejected.\n",
+                       decode_stats.decoded, decode_stats.failed, decode_stats.rejected);
+            }
+            if(_option.is_latest_only && _cap_l && _cap_r) {
+                printf("EndoViewer: [%u/%u] older frames skipped for latency.\n",
+                       _cap_l->getSkippedFrames(), _cap_r->getSkippedFrames());
+            }
+            clock.printStats("EndoViewer: display");
+            printThreadReport();
             break;
         }
         if(key == 'c') {
             is_show_left = !is_show_left;
         }
-
-        auto ms = getDurationSince(time_start);
-#if DO_EFFECIENCY_TEST
-        printf("EndoViewer::showBino: [%ld]ms elapsed.\n", ms);
-#endif
-        if(ms < 17) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(TIME_INTTERVAL - ms));
+        if(key == 'p') {
+            // saved once a full resolution pair arrives
+            _snapshot_pending = true;
         }
     }
 }
 
 
 void EndoViewer::writeVideo() {
+    applyThreadConfig(_option.threads, THREAD_WRITER, "writer");
+    // The file runs at the camera rate, the newest pair is written on each frame time
+    double fps = _capture_fps > 0 ? _capture_fps.load() : 30;
+    FrameClock clock(fps);
     cv::Size size = cv::Size(imwidth * 2, imheight);
-    _writer.open(getCurrentTimeStr() + ".avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30, size, true);
+    _writer.open(getCurrentTimeStr() + ".avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, size, true);
     if (!_writer.isOpened()) {
         std::cout << "EndoViewer: cannot open the video writer!\n";
         std::exit(-1);
     }
 
     cv::Mat bino;
-    bool is_show_left = true;
+    StereoPair pair;
     auto time_org = ::getCurrentTimePoint();
-    while(true) {
+    while(!_should_stop_writer) {
+        clock.wait();
         auto time_start = ::getCurrentTimePoint();
 
-        cv::hconcat(_image_l, _image_r, bino);
-        _writer.write(bino);
+        if(_pairer.getNewest(pair) && pair.eye[0].view.cols == imwidth
+           && pair.eye[1].view.cols == imwidth) {
+            cv::hconcat(pair.eye[0].view, pair.eye[1].view, bino);
+            _writer.write(bino);
+        }
 
         auto ms = getDurationSince(time_start);
 
         if(getDurationSince(time_org) > (60*1000)) {
+            clock.printStats("EndoViewer::writeVideo");
             _writer.release();
-            _writer.open(getCurrentTimeStr() + ".avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30, size, true);
+            _writer.open(getCurrentTimeStr() + ".avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, size, true);
             time_org = ::getCurrentTimePoint();
         }
 #if DO_EFFECIENCY_TEST
         printf("EndoViewer::writeVideo: [%ld]ms elapsed.\n", ms);
 #endif
+    }
+    clock.printStats("EndoViewer::writeVideo");
+    _writer.release();
+}
+
+void EndoViewer::writePassthrough() {
+    applyThreadConfig(_option.threads, THREAD_WRITER, "writer");
+    // One file per eye, the camera payloads are stored as they are
+    AviMjpegWriter writers[2];
+    auto openWriters = [&]() {
+        std::string prefix = getCurrentTimeStr();
+        int fps = static_cast<int>(std::round(_cap_l->getFPS()));
+        bool is_opened = writers[0].open(prefix + "_left.avi", imwidth, imheight, fps)
+                         && writers[1].open(prefix + "_right.avi", imwidth, imheight, fps);
+        if(is_opened) {
+            printf("EndoViewer: start recording MJPEG to %s_{left,right}.avi.\n", prefix.c_str());
+        }
+        return is_opened;
+    };
+    if(!openWriters()) {
+        std::cout << "EndoViewer: cannot open the MJPEG writers!\n";
+        std::exit(-1);
+    }
+
+    RecordFrame frame;
+    auto time_org = ::getCurrentTimePoint();
+    uint64_t dropped = 0;
+    while(true) {
+        {
+            // The frames queued before the stop are still written
+            std::unique_lock<std::mutex> lock(_record_mutex);
+            _record_cond.wait(lock, [this]() { 
+                return !_record_queue.empty() || _should_stop_writer; 
+            });
+            if(_record_queue.empty()) {
+                break;
+            }
+            frame = std::move(_record_queue.front());
+            _record_queue.pop_front();
+            dropped = _record_dropped;
+        }
 
-        if(ms < 17) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(TIME_INTTERVAL - ms));
+#if DO_EFFECIENCY_TEST
+        auto time_start = ::getCurrentTimePoint();
+#endif
+        writers[frame.is_right].write(frame.payload.data(), frame.payload.size(),
+                                      frame.sequence, frame.timestamp_us);
+#if DO_EFFECIENCY_TEST
+        printf("EndoViewer::writePassthrough: [%ld]ms elapsed, [%lu] frames dropped.\n",
+               getDurationSince(time_start), dropped);
+#endif
+
+        {
+            std::lock_guard<std::mutex> lock(_record_mutex);
+            _record_buffers.push_back(std::move(frame.payload));
+        }
+        frame.payload.clear();
+
+        if(getDurationSince(time_org) > (60*1000) || writers[0].isFull() || writers[1].isFull()) {
+            printf("EndoViewer: [%u/%u] frames recorded, [%lu] dropped so far.\n",
+                   writers[0].getFrameCount(), writers[1].getFrameCount(), dropped);
+            if(!openWriters()) {
+                std::cout << "EndoViewer: cannot open the MJPEG writers, recording stopped!\n";
+                return;
+            }
+            time_org = ::getCurrentTimePoint();
         }
     }
-}
\ No newline at end of file
+
+    // The index and the sizes in the headers are only written on close
+    printf("EndoViewer: stop recording, [%u/%u] frames recorded, [%lu] dropped.\n",
+           writers[0].getFrameCount(), writers[1].getFrameCount(), dropped);
+    writers[0].close();
+    writers[1].close();
+}
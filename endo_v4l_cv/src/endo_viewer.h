@@ -2,37 +2,94 @@
 #define H_WLF_C5AA0CDA_9668_4C6C_B6F9_9EEFE7292C64
 #include <thread>
 #include <cstdint>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include <opencv2/opencv.hpp>
+#include "stereo_pairer.h"
+#include "./inc/v4l2_capture.h"
+#include "../../src/define/thread_config.h"
 
-class V4L2Capture;
+class CaptureEngine;
+class DecodePool;
+class CaptureDumpWriter;
+struct v4l2_buffer;
+
+/**
+ * @brief The settable options for EndoViewer.
+ */
+struct EndoViewerOption {
+    EndoViewerOption();
+
+    int64_t pair_tolerance_us;  ///< The largest skew between the left and right frames.
+    bool    is_raw;             ///< Capture YUYV/NV12 instead of MJPEG.
+    bool    is_passthrough;     ///< Record the MJPEG payloads as they are, no decode or re-encode.
+    std::string dump_prefix;    ///< Dump the dequeued buffers to <prefix>_<0/1>.v4ldump by eye, if set.
+    bool    is_latest_only;     ///< Decode only the newest frame, older ones are skipped.
+    uint16_t width;             ///< The requested frame size, the lower bound of MODE_MAX_FPS.
+    uint16_t height;
+    V4L2Capture::ModePolicy mode_policy;    ///< How the camera mode is negotiated.
+    ThreadTopology threads;     ///< The cores and the scheduling of the threads.
+};
 
 class EndoViewer {
 public:
-    EndoViewer();
+    explicit EndoViewer(const EndoViewerOption& option = EndoViewerOption());
     ~EndoViewer();
 
     void startup(uint8_t left_cam_id = 0, uint8_t right_cam_id = 1, bool is_write_to_video = false);
 
-    const uint16_t imwidth;
-    const uint16_t imheight;
+    // The negotiated frame size of both cameras, the requested one until they are up
+    std::atomic<int> imwidth;
+    std::atomic<int> imheight;
 private:
-    void readLeftImage(int index);
-    void readRightImage(int index);
+    EndoViewerOption _option;
+
+    void startCapture(uint8_t left_cam_id, uint8_t right_cam_id);
+    void readImage(size_t device, V4L2Capture& cap, const v4l2_buffer& vbuffer);
+    std::shared_ptr<cv::Mat> acquireImage(bool is_right);
     void show(); // OpenCV can only show window in the same thread
     void writeVideo();
+    void writePassthrough();
+    void queueRecordFrame(bool is_right, V4L2Capture& cap, const v4l2_buffer& vbuffer);
 
-    std::thread _thread_read_l;
-    std::thread _thread_read_r;
+    std::thread _thread_capture;    ///< Brings the cameras up, joined before the teardown.
+    std::atomic<bool> _should_stop; ///< The viewer is going down, the bring-up gives up.
 
     V4L2Capture* _cap_l;
     V4L2Capture* _cap_r;
+    CaptureEngine* _engine;
+    DecodePool* _decode_pool;
+    CaptureDumpWriter* _dumps[2];   ///< Capture dumps of both devices, if requested.
+
+    // Decode targets of each eye, an image is reused once only the pool refers to it.
+    // The pools are only touched by the capture thread.
+    std::vector<std::shared_ptr<cv::Mat>> _images[2];
+    StereoPairer _pairer;
 
-    cv::Mat _image_l;
-    cv::Mat _image_r;
+    std::atomic<int>  _view_width;          ///< The largest displayed width of one eye.
+    std::atomic<int>  _view_height;         ///< The largest displayed height of one eye.
+    std::atomic<bool> _snapshot_pending;    ///< A full resolution snapshot is requested.
+    std::atomic<double> _capture_fps;       ///< The negotiated rate, 0 until the cameras are up.
 
     bool _is_write_to_video;
     cv::VideoWriter  _writer;
-    std::thread _thread_writer;
+    std::thread _thread_writer;     ///< Joined on destruction, so the files are finished.
+    std::atomic<bool> _should_stop_writer;  ///< Drain the queue, close the files and return.
+
+    /** @brief A compressed frame waiting for the passthrough writer. */
+    struct RecordFrame {
+        bool        is_right;
+        uint32_t    sequence;
+        int64_t     timestamp_us;
+        std::vector<uchar> payload;
+    };
+    std::deque<RecordFrame>     _record_queue;
+    std::vector<std::vector<uchar>> _record_buffers;   ///< Payload buffers to reuse.
+    std::mutex                  _record_mutex;
+    std::condition_variable     _record_cond;
+    uint64_t                    _record_dropped;        ///< Frames dropped as the disk lagged.
 };
 
 #endif /* H_WLF_C5AA0CDA_9668_4C6C_B6F9_9EEFE7292C64 */
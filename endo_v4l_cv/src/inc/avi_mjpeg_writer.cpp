@@ -0,0 +1,266 @@
+#include "avi_mjpeg_writer.h"
+#include "mjpeg2jpeg.h"
+#include <iostream>
+#include <cmath>
+
+namespace
+{
+    const uint32_t AVIF_HASINDEX = 0x10;
+    const uint32_t AVIIF_KEYFRAME = 0x10;
+
+    void putU32(std::vector<unsigned char>& out, uint32_t value)
+    {
+        for(int i = 0; i < 4; i++)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    void putU16(std::vector<unsigned char>& out, uint16_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+    }
+
+    void putFourcc(std::vector<unsigned char>& out, const char* fourcc)
+    {
+        out.insert(out.end(), fourcc, fourcc + 4);
+    }
+}
+
+AviMjpegWriter::AviMjpegWriter()
+    : file(nullptr)
+    , timestamp_file(nullptr)
+    , width(0)
+    , height(0)
+    , fps(30)
+    , file_size(0)
+    , max_chunk_size(0)
+    , movi_offset(0)
+    , offsets()
+    , first_timestamp_us(0)
+    , last_timestamp_us(0)
+{
+}
+
+AviMjpegWriter::~AviMjpegWriter()
+{
+    close();
+}
+
+bool AviMjpegWriter::open(const std::string& path, uint width, uint height, double fps)
+{
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if(file == nullptr)
+    {
+        std::cout << "AviMjpegWriter: cannot create " << path << std::endl;
+        return false;
+    }
+    timestamp_file = fopen((path + ".csv").c_str(), "w");
+    if(timestamp_file != nullptr)
+        fprintf(timestamp_file, "frame,sequence,timestamp_us,bytes\n");
+
+    this->width = width;
+    this->height = height;
+    this->fps = fps;
+    max_chunk_size = 0;
+    index.clear();
+
+    std::vector<uchar> hdr;
+    putFourcc(hdr, "RIFF");
+    offsets.riff_size = hdr.size();
+    putU32(hdr, 0);
+    putFourcc(hdr, "AVI ");
+
+    putFourcc(hdr, "LIST");
+    putU32(hdr, 4 + (8 + 56) + (8 + 4 + (8 + 56) + (8 + 40)));
+    putFourcc(hdr, "hdrl");
+
+    // MainAVIHeader
+    putFourcc(hdr, "avih");
+    putU32(hdr, 56);
+    offsets.micro_sec_per_frame = hdr.size();
+    putU32(hdr, 0);
+    offsets.max_bytes_per_sec = hdr.size();
+    putU32(hdr, 0);
+    putU32(hdr, 0);                 // padding granularity
+    putU32(hdr, AVIF_HASINDEX);
+    offsets.total_frames = hdr.size();
+    putU32(hdr, 0);
+    putU32(hdr, 0);                 // initial frames
+    putU32(hdr, 1);                 // streams
+    offsets.avih_buffer_size = hdr.size();
+    putU32(hdr, 0);
+    putU32(hdr, width);
+    putU32(hdr, height);
+    for(int i = 0; i < 4; i++)
+        putU32(hdr, 0);
+
+    putFourcc(hdr, "LIST");
+    putU32(hdr, 4 + (8 + 56) + (8 + 40));
+    putFourcc(hdr, "strl");
+
+    // AVIStreamHeader
+    putFourcc(hdr, "strh");
+    putU32(hdr, 56);
+    putFourcc(hdr, "vids");
+    putFourcc(hdr, "MJPG");
+    putU32(hdr, 0);                 // flags
+    putU16(hdr, 0);                 // priority
+    putU16(hdr, 0);                 // language
+    putU32(hdr, 0);                 // initial frames
+    offsets.scale = hdr.size();
+    putU32(hdr, 0);
+    offsets.rate = hdr.size();
+    putU32(hdr, 0);
+    putU32(hdr, 0);                 // start
+    offsets.length = hdr.size();
+    putU32(hdr, 0);
+    offsets.strh_buffer_size = hdr.size();
+    putU32(hdr, 0);
+    putU32(hdr, 0xffffffff);        // quality, default
+    putU32(hdr, 0);                 // sample size, varies
+    putU16(hdr, 0);
+    putU16(hdr, 0);
+    putU16(hdr, static_cast<uint16_t>(width));
+    putU16(hdr, static_cast<uint16_t>(height));
+
+    // BITMAPINFOHEADER
+    putFourcc(hdr, "strf");
+    putU32(hdr, 40);
+    putU32(hdr, 40);
+    putU32(hdr, width);
+    putU32(hdr, height);
+    putU16(hdr, 1);                 // planes
+    putU16(hdr, 24);                // bit count
+    putFourcc(hdr, "MJPG");
+    putU32(hdr, width * height * 3);
+    for(int i = 0; i < 4; i++)
+        putU32(hdr, 0);
+
+    putFourcc(hdr, "LIST");
+    offsets.movi_size = hdr.size();
+    putU32(hdr, 0);
+    movi_offset = hdr.size();
+    putFourcc(hdr, "movi");
+
+    file_size = 0;
+    if(!writeBytes(hdr.data(), hdr.size()))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AviMjpegWriter::write(const uchar* jpeg, uint size, uint sequence, int64_t timestamp_us)
+{
+    if(file == nullptr)
+        return false;
+    if(size < 4 || jpeg[0] != 0xff || jpeg[1] != 0xd8)
+    {
+        std::cout << "AviMjpegWriter: frame " << sequence << " is no JPEG image, skipped\n";
+        return false;
+    }
+
+    // SOI, then the DHT segment if the camera omitted it, then the rest of the payload
+    uint dht_size = 0;
+    const uchar* dht = hasHuffmanTable(jpeg, size) ? nullptr : getHuffmanTable(&dht_size);
+    uint chunk_size = size + dht_size;
+
+    IndexEntry entry;
+    entry.offset = static_cast<uint32_t>(file_size - movi_offset);
+    entry.size = chunk_size;
+
+    uchar header[8] = { '0', '0', 'd', 'c' };
+    for(int i = 0; i < 4; i++)
+        header[4 + i] = static_cast<uchar>(chunk_size >> (8 * i));
+    static const uchar pad = 0;
+    bool ok = writeBytes(header, sizeof(header)) && writeBytes(jpeg, 2);
+    if(ok && dht != nullptr)
+        ok = writeBytes(dht, dht_size);
+    ok = ok && writeBytes(jpeg + 2, size - 2);
+    if(ok && (chunk_size & 1))
+        ok = writeBytes(&pad, 1);
+    if(!ok)
+    {
+        std::cout << "AviMjpegWriter: write failed, recording stopped\n";
+        close();
+        return false;
+    }
+
+    if(index.empty())
+        first_timestamp_us = timestamp_us;
+    last_timestamp_us = timestamp_us;
+    index.push_back(entry);
+    if(chunk_size > max_chunk_size)
+        max_chunk_size = chunk_size;
+    if(timestamp_file != nullptr)
+        fprintf(timestamp_file, "%u,%u,%lld,%u\n", getFrameCount() - 1, sequence,
+                static_cast<long long>(timestamp_us), size);
+    return true;
+}
+
+void AviMjpegWriter::close()
+{
+    if(file == nullptr)
+        return;
+
+    // idx1, the offsets are relative to the 'movi' fourcc
+    std::vector<uchar> idx;
+    putFourcc(idx, "idx1");
+    putU32(idx, static_cast<uint32_t>(index.size() * 16));
+    for(const auto& entry : index)
+    {
+        putFourcc(idx, "00dc");
+        putU32(idx, AVIIF_KEYFRAME);
+        putU32(idx, entry.offset);
+        putU32(idx, entry.size);
+    }
+    uint64_t movi_end = file_size;
+    writeBytes(idx.data(), idx.size());
+
+    // The frame rate is measured, the cameras do not always deliver the nominal one
+    uint frames = getFrameCount();
+    double rate = fps;
+    if(frames > 1 && last_timestamp_us > first_timestamp_us)
+        rate = (frames - 1) * 1e6 / (last_timestamp_us - first_timestamp_us);
+    uint32_t rate_scale = 1000;
+    uint32_t rate_value = static_cast<uint32_t>(std::lround(rate * rate_scale));
+
+    writeU32At(offsets.riff_size, static_cast<uint32_t>(file_size - 8));
+    writeU32At(offsets.micro_sec_per_frame, static_cast<uint32_t>(std::lround(1e6 / rate)));
+    writeU32At(offsets.max_bytes_per_sec, static_cast<uint32_t>(max_chunk_size * rate));
+    writeU32At(offsets.total_frames, frames);
+    writeU32At(offsets.avih_buffer_size, max_chunk_size);
+    writeU32At(offsets.scale, rate_scale);
+    writeU32At(offsets.rate, rate_value);
+    writeU32At(offsets.length, frames);
+    writeU32At(offsets.strh_buffer_size, max_chunk_size);
+    writeU32At(offsets.movi_size, static_cast<uint32_t>(movi_end - movi_offset));
+
+    fclose(file);
+    file = nullptr;
+    if(timestamp_file != nullptr)
+    {
+        fclose(timestamp_file);
+        timestamp_file = nullptr;
+    }
+}
+
+bool AviMjpegWriter::writeBytes(const void* data, uint size)
+{
+    if(fwrite(data, 1, size, file) != size)
+        return false;
+    file_size += size;
+    return true;
+}
+
+void AviMjpegWriter::writeU32At(long offset, uint32_t value)
+{
+    uchar bytes[4];
+    for(int i = 0; i < 4; i++)
+        bytes[i] = static_cast<uchar>(value >> (8 * i));
+    fseek(file, offset, SEEK_SET);
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
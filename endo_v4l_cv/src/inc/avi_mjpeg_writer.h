@@ -0,0 +1,99 @@
+#ifndef AVI_MJPEG_WRITER_H
+#define AVI_MJPEG_WRITER_H
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** @brief Writes MJPEG frames as they came from the camera into an AVI (RIFF) file.
+ * Nothing is decoded or encoded, each payload is stored as one '00dc' chunk, with the
+ * standard DHT segment inserted when the camera left it out, so that any player can
+ * decode the file. The kernel timestamp of every frame goes to "<path>.csv", since AVI
+ * only knows a constant frame rate; the rate in the header is measured from the
+ * timestamps when the file is closed.
+ * The file is kept below 1 GB, the limit of AVI 1.0 readers, see isFull().
+ */
+class AviMjpegWriter
+{
+    using uint = unsigned int;
+    using uchar = unsigned char;
+public:
+    AviMjpegWriter();
+    ~AviMjpegWriter();
+
+    AviMjpegWriter(const AviMjpegWriter&) = delete;
+    AviMjpegWriter& operator=(const AviMjpegWriter&) = delete;
+
+    /** @brief Create the file and write the headers
+     * @param path    the path of the AVI file
+     * @param width   the image width
+     * @param height  the image height
+     * @param fps     the frame rate stored if fewer than two frames are written
+     */
+    bool open(const std::string& path, uint width, uint height, double fps);
+
+    /** @brief Append a compressed frame
+     * @param jpeg          the MJPEG payload of the V4L2 buffer
+     * @param size          vbuffer.bytesused
+     * @param sequence      vbuffer.sequence
+     * @param timestamp_us  the kernel timestamp in microseconds
+     * @return false if the payload is no JPEG image or the file cannot be written
+     */
+    bool write(const uchar* jpeg, uint size, uint sequence, int64_t timestamp_us);
+
+    /** @brief Write the index, fix up the headers and close the file
+     */
+    void close();
+
+    bool isOpened() const { return file != nullptr; }
+
+    /** @brief Whether the next frame could exceed the size limit, open a new file then
+     */
+    bool isFull() const { return file_size + max_chunk_size > MAX_FILE_SIZE; }
+
+    /** @brief The number of frames in the current file
+     */
+    uint getFrameCount() const { return static_cast<uint>(index.size()); }
+
+private:
+    bool writeBytes(const void* data, uint size);
+    void writeU32At(long offset, uint32_t value);
+
+private:
+    static const uint64_t MAX_FILE_SIZE = 1ull << 30;
+
+    struct IndexEntry
+    {
+        uint32_t offset;    // from the 'movi' fourcc to the chunk header
+        uint32_t size;      // the chunk data size, without padding
+    };
+
+    // The offsets of the header fields fixed up by close()
+    struct HeaderOffsets
+    {
+        long riff_size;
+        long micro_sec_per_frame;
+        long max_bytes_per_sec;
+        long total_frames;
+        long avih_buffer_size;
+        long scale;
+        long rate;
+        long length;
+        long strh_buffer_size;
+        long movi_size;
+    };
+
+    FILE   *file;
+    FILE   *timestamp_file;
+    uint    width;
+    uint    height;
+    double  fps;
+    uint64_t file_size;
+    uint    max_chunk_size;
+    long    movi_offset;        // file offset of the 'movi' fourcc
+    HeaderOffsets offsets;
+    int64_t first_timestamp_us;
+    int64_t last_timestamp_us;
+    std::vector<IndexEntry> index;
+};
+#endif  // AVI_MJPEG_WRITER_H
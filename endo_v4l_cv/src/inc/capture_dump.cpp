@@ -0,0 +1,240 @@
+#include "capture_dump.h"
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+    const char DUMP_MAGIC[8] = { 'V', '4', 'L', 'D', 'U', 'M', 'P', '1' };
+    const char INDEX_MAGIC[8] = { 'V', '4', 'L', 'I', 'D', 'X', '1', '\0' };
+    const uint32_t HEADER_SIZE = 8 + 5 * 4;
+    const uint32_t RECORD_HEADER_SIZE = 4 + 4 + 8;
+    const uint32_t TRAILER_SIZE = 8 + 4 + 8;
+
+    // The payloads are multi-megabyte at most, a larger size means a corrupt record
+    const uint32_t MAX_PAYLOAD_SIZE = 64u << 20;
+
+    void putU32(unsigned char* out, uint32_t value)
+    {
+        for(int i = 0; i < 4; i++)
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    void putU64(unsigned char* out, uint64_t value)
+    {
+        for(int i = 0; i < 8; i++)
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    uint32_t getU32(const unsigned char* in)
+    {
+        uint32_t value = 0;
+        for(int i = 3; i >= 0; i--)
+            value = (value << 8) | in[i];
+        return value;
+    }
+
+    uint64_t getU64(const unsigned char* in)
+    {
+        uint64_t value = 0;
+        for(int i = 7; i >= 0; i--)
+            value = (value << 8) | in[i];
+        return value;
+    }
+
+    uint32_t padded(uint32_t size)
+    {
+        return (size + 7) & ~7u;
+    }
+}
+
+CaptureDumpWriter::CaptureDumpWriter()
+    : file(nullptr)
+    , file_size(0)
+{
+}
+
+CaptureDumpWriter::~CaptureDumpWriter()
+{
+    close();
+}
+
+bool CaptureDumpWriter::open(const std::string& path, const CaptureDumpFormat& format)
+{
+    close();
+    file = fopen(path.c_str(), "wb");
+    if(file == nullptr)
+    {
+        std::cout << "CaptureDumpWriter: cannot create " << path << std::endl;
+        return false;
+    }
+
+    unsigned char header[HEADER_SIZE] = { 0 };
+    memcpy(header, DUMP_MAGIC, sizeof(DUMP_MAGIC));
+    putU32(header + 8, format.pixel_format);
+    putU32(header + 12, format.width);
+    putU32(header + 16, format.height);
+    putU32(header + 20, format.bytes_per_line);
+    if(fwrite(header, 1, sizeof(header), file) != sizeof(header))
+    {
+        close();
+        return false;
+    }
+    file_size = sizeof(header);
+    offsets.clear();
+    return true;
+}
+
+bool CaptureDumpWriter::write(const void* payload, uint bytesused, uint sequence, int64_t timestamp_us)
+{
+    if(file == nullptr)
+        return false;
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    putU32(header, sequence);
+    putU32(header + 4, bytesused);
+    putU64(header + 8, static_cast<uint64_t>(timestamp_us));
+    static const unsigned char pad[8] = { 0 };
+    uint pad_size = padded(bytesused) - bytesused;
+    if(fwrite(header, 1, sizeof(header), file) != sizeof(header)
+       || fwrite(payload, 1, bytesused, file) != bytesused
+       || fwrite(pad, 1, pad_size, file) != pad_size)
+    {
+        std::cout << "CaptureDumpWriter: write failed, dump stopped\n";
+        close();
+        return false;
+    }
+    offsets.push_back(file_size);
+    file_size += sizeof(header) + bytesused + pad_size;
+    return true;
+}
+
+void CaptureDumpWriter::close()
+{
+    if(file == nullptr)
+        return;
+
+    std::vector<unsigned char> index(offsets.size() * 8 + TRAILER_SIZE);
+    for(size_t i = 0; i < offsets.size(); i++)
+        putU64(&index[i * 8], offsets[i]);
+    unsigned char* trailer = &index[offsets.size() * 8];
+    putU64(trailer, file_size);
+    putU32(trailer + 8, static_cast<uint32_t>(offsets.size()));
+    memcpy(trailer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    fwrite(index.data(), 1, index.size(), file);
+
+    fclose(file);
+    file = nullptr;
+}
+
+
+CaptureDumpReader::CaptureDumpReader()
+    : file(nullptr)
+    , format()
+{
+}
+
+CaptureDumpReader::~CaptureDumpReader()
+{
+    close();
+}
+
+bool CaptureDumpReader::open(const std::string& path)
+{
+    close();
+    file = fopen(path.c_str(), "rb");
+    if(file == nullptr)
+    {
+        std::cout << "CaptureDumpReader: cannot open " << path << std::endl;
+        return false;
+    }
+
+    unsigned char header[HEADER_SIZE];
+    if(fread(header, 1, sizeof(header), file) != sizeof(header)
+       || memcmp(header, DUMP_MAGIC, sizeof(DUMP_MAGIC)) != 0)
+    {
+        std::cout << "CaptureDumpReader: " << path << " is no capture dump\n";
+        close();
+        return false;
+    }
+    format.pixel_format = getU32(header + 8);
+    format.width = getU32(header + 12);
+    format.height = getU32(header + 16);
+    format.bytes_per_line = getU32(header + 20);
+
+    if(!readIndex() && !scanRecords())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureDumpReader::close()
+{
+    if(file != nullptr)
+        fclose(file);
+    file = nullptr;
+    offsets.clear();
+}
+
+bool CaptureDumpReader::read(uint index, CaptureDumpFrame& frame)
+{
+    if(file == nullptr || index >= offsets.size())
+        return false;
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    if(fseek(file, static_cast<long>(offsets[index]), SEEK_SET) != 0
+       || fread(header, 1, sizeof(header), file) != sizeof(header))
+        return false;
+    uint32_t bytesused = getU32(header + 4);
+    if(bytesused > MAX_PAYLOAD_SIZE)
+        return false;
+
+    frame.sequence = getU32(header);
+    frame.timestamp_us = static_cast<int64_t>(getU64(header + 8));
+    frame.payload.resize(bytesused);
+    return fread(frame.payload.data(), 1, bytesused, file) == bytesused;
+}
+
+bool CaptureDumpReader::readIndex()
+{
+    unsigned char trailer[TRAILER_SIZE];
+    if(fseek(file, -static_cast<long>(TRAILER_SIZE), SEEK_END) != 0
+       || fread(trailer, 1, sizeof(trailer), file) != sizeof(trailer)
+       || memcmp(trailer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return false;
+
+    uint64_t index_offset = getU64(trailer);
+    uint32_t count = getU32(trailer + 8);
+    std::vector<unsigned char> index(size_t(count) * 8);
+    if(fseek(file, static_cast<long>(index_offset), SEEK_SET) != 0
+       || fread(index.data(), 1, index.size(), file) != index.size())
+        return false;
+
+    offsets.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+        offsets[i] = getU64(&index[i * 8]);
+    return true;
+}
+
+bool CaptureDumpReader::scanRecords()
+{
+    std::cout << "CaptureDumpReader: no index, scanning the records\n";
+    offsets.clear();
+    uint64_t offset = HEADER_SIZE;
+    unsigned char header[RECORD_HEADER_SIZE];
+    while(fseek(file, static_cast<long>(offset), SEEK_SET) == 0
+          && fread(header, 1, sizeof(header), file) == sizeof(header))
+    {
+        uint32_t bytesused = getU32(header + 4);
+        if(bytesused > MAX_PAYLOAD_SIZE)
+            break;
+        uint64_t next = offset + sizeof(header) + padded(bytesused);
+        // the last record may be cut off
+        if(fseek(file, static_cast<long>(next) - 1, SEEK_SET) != 0 || fgetc(file) == EOF)
+            break;
+        offsets.push_back(offset);
+        offset = next;
+    }
+    return !offsets.empty();
+}
@@ -0,0 +1,103 @@
+#ifndef CAPTURE_DUMP_H
+#define CAPTURE_DUMP_H
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* The dump file of one V4L2 device, the dequeued buffers exactly as the driver filled them.
+
+   header  : "V4LDUMP1", then the stream format as uint32 (little endian)
+             pixel_format, width, height, bytes_per_line, reserved
+   records : per buffer, uint32 sequence, uint32 bytesused, int64 timestamp_us, followed by
+             the payload padded to 8 bytes
+   index   : uint64 offset of each record, then uint64 index offset, uint32 record count and
+             "V4LIDX1" with a terminating zero
+
+   A dump whose index is missing, e.g. the recording was killed, is read by scanning the
+   records. */
+
+/** @brief The stream format of a dump
+ */
+struct CaptureDumpFormat
+{
+    uint32_t pixel_format;      // V4L2_PIX_FMT_*
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_line;    // row pitch of raw frames, 0 for MJPEG
+};
+
+/** @brief One recorded buffer
+ */
+struct CaptureDumpFrame
+{
+    uint32_t sequence;          // vbuffer.sequence
+    int64_t  timestamp_us;      // the kernel timestamp
+    std::vector<unsigned char> payload;     // vbuffer.bytesused bytes
+};
+
+/** @brief Appends dequeued buffers to a dump file
+ */
+class CaptureDumpWriter
+{
+    using uint = unsigned int;
+public:
+    CaptureDumpWriter();
+    ~CaptureDumpWriter();
+
+    CaptureDumpWriter(const CaptureDumpWriter&) = delete;
+    CaptureDumpWriter& operator=(const CaptureDumpWriter&) = delete;
+
+    bool open(const std::string& path, const CaptureDumpFormat& format);
+
+    /** @brief Append the payload of a buffer, called before it is queued again
+     */
+    bool write(const void* payload, uint bytesused, uint sequence, int64_t timestamp_us);
+
+    /** @brief Write the index and close the file
+     */
+    void close();
+
+    bool isOpened() const { return file != nullptr; }
+
+    uint getFrameCount() const { return static_cast<uint>(offsets.size()); }
+
+private:
+    FILE       *file;
+    uint64_t    file_size;
+    std::vector<uint64_t> offsets;
+};
+
+/** @brief Reads the buffers of a dump file, in order or at random
+ */
+class CaptureDumpReader
+{
+    using uint = unsigned int;
+public:
+    CaptureDumpReader();
+    ~CaptureDumpReader();
+
+    CaptureDumpReader(const CaptureDumpReader&) = delete;
+    CaptureDumpReader& operator=(const CaptureDumpReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const CaptureDumpFormat& getFormat() const { return format; }
+
+    uint getFrameCount() const { return static_cast<uint>(offsets.size()); }
+
+    /** @brief Read a frame, the payload buffer of frame is reused
+     */
+    bool read(uint index, CaptureDumpFrame& frame);
+
+private:
+    bool readIndex();
+    bool scanRecords();
+
+private:
+    FILE       *file;
+    CaptureDumpFormat format;
+    std::vector<uint64_t> offsets;
+};
+#endif  // CAPTURE_DUMP_H
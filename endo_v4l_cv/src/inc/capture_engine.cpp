@@ -0,0 +1,129 @@
+#include "capture_engine.h"
+#include "v4l2_capture.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+    const int MAX_EVENTS = 16;
+    const uint64_t WAKEUP_TAG = ~0ull;
+}
+
+CaptureEngine::CaptureEngine(FrameHandler handler)
+    : handler(handler)
+    , epoll_fd(-1)
+    , wakeup_fd(-1)
+    , running(false)
+{
+}
+
+void CaptureEngine::setThreadInit(std::function<void()> init)
+{
+    thread_init = init;
+}
+
+CaptureEngine::~CaptureEngine()
+{
+    stop();
+}
+
+size_t CaptureEngine::addDevice(V4L2Capture* capture)
+{
+    devices.push_back(capture);
+    return devices.size() - 1;
+}
+
+bool CaptureEngine::start()
+{
+    if(running)
+        return true;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(epoll_fd == -1 || wakeup_fd == -1)
+    {
+        std::cout << "CaptureEngine: cannot create epoll, " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = WAKEUP_TAG;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event);
+
+    for(size_t i = 0; i < devices.size(); i++)
+    {
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLPRI;
+        event.data.u64 = i;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, devices[i]->getFd(), &event) == -1)
+        {
+            std::cout << "CaptureEngine: cannot watch device " << i << ", " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    running = true;
+    poll_thread = std::thread(&CaptureEngine::pollLoop, this);
+    return true;
+}
+
+void CaptureEngine::stop()
+{
+    if(running.exchange(false))
+    {
+        uint64_t one = 1;
+        if(write(wakeup_fd, &one, sizeof(one)) != sizeof(one))
+            std::cout << "CaptureEngine: cannot wake up the poll loop\n";
+        poll_thread.join();
+    }
+    if(epoll_fd != -1)
+        close(epoll_fd);
+    if(wakeup_fd != -1)
+        close(wakeup_fd);
+    epoll_fd = wakeup_fd = -1;
+}
+
+void CaptureEngine::pollLoop()
+{
+    if(thread_init)
+        thread_init();
+    epoll_event events[MAX_EVENTS];
+    while(running)
+    {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if(n == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            std::cout << "CaptureEngine: epoll_wait failed, " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for(int i = 0; i < n; i++)
+        {
+            if(events[i].data.u64 == WAKEUP_TAG)
+                continue;
+
+            size_t index = events[i].data.u64;
+            V4L2Capture& device = *devices[index];
+            if(events[i].events & EPOLLERR)
+            {
+                // the device is gone, stop watching it rather than spinning on the error
+                std::cout << "CaptureEngine: error is reported for device " << index << std::endl;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device.getFd(), nullptr);
+                continue;
+            }
+
+            v4l2_buffer vbuffer;
+            if(!device.dequeueBuffer(vbuffer))
+                continue;
+
+            handler(index, device, vbuffer);
+            device.queueBuffer(vbuffer);
+        }
+    }
+}
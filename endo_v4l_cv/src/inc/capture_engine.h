@@ -0,0 +1,63 @@
+#ifndef CAPTURE_ENGINE_H
+#define CAPTURE_ENGINE_H
+#include <linux/videodev2.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+class V4L2Capture;
+
+/** @brief Services any number of V4L2Capture devices from one epoll loop.
+ * A buffer is dequeued as soon as the kernel reports its device readable, handed to the
+ * frame handler and re-queued right after, so the driver is never short of buffers. The
+ * handler is expected to copy the payload and leave the decode to a DecodePool.
+ */
+class CaptureEngine
+{
+public:
+    /** @brief Called on the poll thread for every dequeued buffer.
+     * The buffer is re-queued once the handler returns, keep it short.
+     * @param device   the index returned by addDevice()
+     * @param capture  the device the buffer belongs to
+     * @param vbuffer  the dequeued buffer
+     */
+    using FrameHandler = std::function<void(size_t device, V4L2Capture& capture, const v4l2_buffer& vbuffer)>;
+
+    explicit CaptureEngine(FrameHandler handler);
+    ~CaptureEngine();
+
+    CaptureEngine(const CaptureEngine&) = delete;
+    CaptureEngine& operator=(const CaptureEngine&) = delete;
+
+    /** @brief Add an opened device, only allowed before start()
+     * @return the index of the device, passed to the frame handler
+     */
+    size_t addDevice(V4L2Capture* capture);
+
+    /** @brief Set a function run first on the poll thread, e.g. to pin it, only allowed
+     * before start()
+     */
+    void setThreadInit(std::function<void()> init);
+
+    /** @brief Start the epoll loop
+     */
+    bool start();
+
+    /** @brief Stop the loop and join the poll thread
+     */
+    void stop();
+
+private:
+    void pollLoop();
+
+private:
+    FrameHandler    handler;
+    std::function<void()> thread_init;
+    std::vector<V4L2Capture*> devices;
+    int             epoll_fd;
+    int             wakeup_fd;      // eventfd to interrupt epoll_wait on stop()
+    std::thread     poll_thread;
+    std::atomic<bool> running;
+};
+#endif  // CAPTURE_ENGINE_H
@@ -0,0 +1,132 @@
+#include "decode_pool.h"
+#include "jpeg_decoder.h"
+#include <cstring>
+
+DecodePool::DecodePool(size_t device_count, bool bgr, uint worker_count/* = 0 */, uint max_inflight/* = 4 */,
+                       std::function<void(uint)> thread_init/* = nullptr */)
+    : max_inflight(max_inflight)
+    , bgr(bgr)
+    , devices(device_count)
+    , stats()
+    , running(true)
+{
+    if(worker_count == 0)
+    {
+        uint cores = std::thread::hardware_concurrency();
+        worker_count = cores > 1 ? cores - 1 : 1;
+    }
+    for(auto& device : devices)
+        device.delivering = false;
+    for(uint i = 0; i < worker_count; i++)
+        workers.push_back(std::thread(&DecodePool::workLoop, this, i, thread_init));
+}
+
+DecodePool::~DecodePool()
+{
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+        cond.notify_all();
+    }
+    for(auto& worker : workers)
+        worker.join();
+}
+
+bool DecodePool::submit(size_t device, uint sequence, const void* payload, uint size,
+                        uchar* data, int width, int pitch, int height, int scale, Callback done)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if(devices[device].inflight.size() >= max_inflight)
+        {
+            stats.rejected++;
+            return false;
+        }
+        if(!spare_payloads.empty())
+        {
+            job->payload.swap(spare_payloads.back());
+            spare_payloads.pop_back();
+        }
+    }
+
+    // the copy is done out of the lock, it is the only work left on the capture thread
+    job->payload.resize(size);
+    memcpy(job->payload.data(), payload, size);
+    job->device = device;
+    job->sequence = sequence;
+    job->data = data;
+    job->width = width;
+    job->pitch = pitch;
+    job->height = height;
+    job->scale = scale;
+    job->done = done;
+    job->finished = false;
+    job->success = false;
+
+    std::lock_guard<std::mutex> lck(mtx);
+    devices[device].inflight.push_back(job);
+    jobs.push_back(job);
+    cond.notify_one();
+    return true;
+}
+
+DecodePool::Stats DecodePool::getStats()
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    return stats;
+}
+
+void DecodePool::workLoop(uint index, std::function<void(uint)> thread_init)
+{
+    if(thread_init)
+        thread_init(index);
+    JpegDecoder decoder(bgr);
+    while(true)
+    {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            cond.wait(lck, [this]{ return !running || !jobs.empty(); });
+            if(!running)
+                return;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        job->success = decoder.decode(job->payload.data(), job->payload.size(), job->data,
+                                      job->width, job->pitch, job->height, job->scale);
+        complete(job);
+    }
+}
+
+void DecodePool::complete(const std::shared_ptr<Job>& job)
+{
+    std::unique_lock<std::mutex> lck(mtx);
+    job->finished = true;
+    if(job->success)
+        stats.decoded++;
+    else
+        stats.failed++;
+
+    // only one thread at a time delivers the frames of a device, the others just leave
+    // their finished job for it
+    Device& device = devices[job->device];
+    if(device.delivering)
+        return;
+    device.delivering = true;
+    while(!device.inflight.empty() && device.inflight.front()->finished)
+    {
+        std::shared_ptr<Job> front = device.inflight.front();
+        device.inflight.pop_front();
+
+        lck.unlock();
+        front->done(front->success);
+        front->done = nullptr;
+        lck.lock();
+
+        spare_payloads.push_back(std::vector<uchar>());
+        spare_payloads.back().swap(front->payload);
+    }
+    device.delivering = false;
+}
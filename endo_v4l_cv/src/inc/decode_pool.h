@@ -0,0 +1,105 @@
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @brief Decodes MJPEG frames of several devices on a pool of worker threads.
+ * The compressed payload is copied on submit(), so the V4L2 buffer can be re-queued at
+ * once. Each worker owns its JpegDecoder. Frames of one device are delivered in the order
+ * of their sequence numbers, no matter which worker finishes first.
+ */
+class DecodePool
+{
+    using uint = unsigned int;
+    using uchar = unsigned char;
+public:
+    /** @brief Called once per submitted frame, in sequence order per device
+     * @param success  false if the frame is corrupt and its destination should be dropped
+     */
+    using Callback = std::function<void(bool success)>;
+
+    /** @brief Decode statistics
+     */
+    struct Stats
+    {
+        uint64_t decoded;       // frames decoded successfully
+        uint64_t failed;        // corrupt frames
+        uint64_t rejected;      // frames refused because the device had too many in flight
+    };
+
+    /** @brief Start the worker threads
+     * @param device_count  the number of devices submitting frames
+     * @param bgr           decode to BGR instead of RGB
+     * @param worker_count  the number of decode threads, 0 for one per core but one
+     * @param max_inflight  the most frames of one device queued or being decoded
+     * @param thread_init   run first on each worker with its index, e.g. to pin it
+     */
+    DecodePool(size_t device_count, bool bgr, uint worker_count = 0, uint max_inflight = 4,
+               std::function<void(uint)> thread_init = nullptr);
+    ~DecodePool();
+
+    DecodePool(const DecodePool&) = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+
+    /** @brief Copy a compressed frame and queue it for decoding
+     * @param device    the device of the frame, less than device_count
+     * @param sequence  the V4L2 sequence number of the frame
+     * @param payload   the compressed frame, only read during the call
+     * @param size      the size of the compressed frame
+     * @param data      the destination frame, it must stay valid until done is called
+     * @param width     the image width
+     * @param pitch     bytes per row of data, 0 for a continuous frame
+     * @param height    the image height
+     * @param scale     decode at 1/scale of the size, see JpegDecoder::chooseScale()
+     * @param done      called after decoding, with the sequence order of the device kept
+     * @return false if the frame is refused, done will not be called then
+     */
+    bool submit(size_t device, uint sequence, const void* payload, uint size,
+                uchar* data, int width, int pitch, int height, int scale, Callback done);
+
+    Stats getStats();
+
+private:
+    struct Job
+    {
+        size_t  device;
+        uint    sequence;
+        std::vector<uchar> payload;
+        uchar*  data;
+        int     width;
+        int     pitch;
+        int     height;
+        int     scale;
+        Callback done;
+        bool    finished;
+        bool    success;
+    };
+
+    struct Device
+    {
+        std::deque<std::shared_ptr<Job>> inflight;  // in sequence order
+        bool    delivering;     // a worker is calling the callbacks of this device
+    };
+
+    void workLoop(uint index, std::function<void(uint)> thread_init);
+    void complete(const std::shared_ptr<Job>& job);
+
+private:
+    const uint  max_inflight;
+    const bool  bgr;
+    std::vector<std::thread> workers;
+    std::mutex  mtx;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<Job>> jobs;     // waiting for a worker
+    std::vector<Device> devices;
+    std::vector<std::vector<uchar>> spare_payloads;   // recycled payload buffers
+    Stats       stats;
+    bool        running;
+};
+#endif  // DECODE_POOL_H
@@ -0,0 +1,81 @@
+#include "jpeg_decoder.h"
+#include <turbojpeg.h>
+#include <iostream>
+
+JpegDecoder::JpegDecoder(bool bgr/* = false */)
+    : handle(tjInitDecompress())
+    , bgr(bgr)
+    , has_header(false)
+    , width(0)
+    , height(0)
+    , subsamp(-1)
+    , error_count(0)
+{
+    if(handle == nullptr)
+        std::cout << "tjInitDecompress failed: " << tjGetErrorStr2(nullptr) << std::endl;
+}
+
+JpegDecoder::~JpegDecoder()
+{
+    if(handle != nullptr)
+        tjDestroy(handle);
+}
+
+bool JpegDecoder::decode(const uchar* jpeg, unsigned long size, uchar* data, int width, int pitch, int height, int scale/* = 1 */)
+{
+    if(handle == nullptr)
+        return false;
+
+    // the cached header is checked again when the expected size changes, a decoder shared
+    // by cameras of different resolutions then re-parses only when switching
+    bool has_size = has_header && this->width == width && this->height == height;
+    if(!has_size && !parseHeader(jpeg, size))
+    {
+        error_count++;
+        return false;
+    }
+    if(this->width != width || this->height != height)
+    {
+        std::cout << "JpegDecoder: image is " << this->width << "x" << this->height
+                  << ", but " << width << "x" << height << " is expected\n";
+        error_count++;
+        return false;
+    }
+
+    // a smaller destination makes libjpeg-turbo pick the matching scaling factor
+    int out_width = getScaledSize(width, scale);
+    int out_height = getScaledSize(height, scale);
+
+    // the channel order is written by the colour conversion of the decoder itself, no
+    // extra pass is needed for BGR
+    // a warning means corrupt data here, e.g. a truncated frame, so stop and drop it
+    if(tjDecompress2(handle, jpeg, size, data, out_width, pitch, out_height, bgr ? TJPF_BGR : TJPF_RGB,
+                     TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE | TJFLAG_STOPONWARNING) == -1)
+    {
+        std::cout << "JpegDecoder: " << (tjGetErrorCode(handle) == TJERR_WARNING ? "corrupt frame" : "decode failed")
+                  << ", " << tjGetErrorStr2(handle) << std::endl;
+        error_count++;
+        return false;
+    }
+    return true;
+}
+
+bool JpegDecoder::parseHeader(const uchar* jpeg, unsigned long size)
+{
+    int colorspace;
+    if(tjDecompressHeader3(handle, jpeg, size, &width, &height, &subsamp, &colorspace) == -1)
+    {
+        std::cout << "JpegDecoder: invalid header, " << tjGetErrorStr2(handle) << std::endl;
+        return false;
+    }
+    has_header = true;
+    return true;
+}
+
+int JpegDecoder::chooseScale(int width, int height, int target_width, int target_height)
+{
+    int scale = 8;
+    while(scale > 1 && (getScaledSize(width, scale) < target_width || getScaledSize(height, scale) < target_height))
+        scale /= 2;
+    return scale;
+}
@@ -0,0 +1,73 @@
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+
+/** @brief A long-lived libjpeg-turbo decompressor.
+ * The tjhandle is created once and reused for every frame. Since the resolution and the
+ * subsampling of a camera stream never change mid-stream, the JPEG header is parsed for
+ * the first frame only, until reset() is called.
+ * A decoder is not thread-safe, use one instance per capture or per worker thread. The
+ * header is parsed again whenever the expected size differs from the cached one.
+ */
+class JpegDecoder
+{
+    using uint = unsigned int;
+    using uchar = unsigned char;
+public:
+    /** @param bgr  emit BGR instead of RGB, fixed for the lifetime of the decoder
+     */
+    explicit JpegDecoder(bool bgr = false);
+    ~JpegDecoder();
+
+    JpegDecoder(const JpegDecoder&) = delete;
+    JpegDecoder& operator=(const JpegDecoder&) = delete;
+
+    /** @brief Decode a JPEG/MJPEG image into an RGB (or BGR) frame
+     * @param jpeg    the compressed image
+     * @param size    the size of the compressed image
+     * @param data    the destination frame, getScaledSize() of width x height
+     * @param width   the expected image width
+     * @param pitch   bytes per row of data, 0 for a continuous frame
+     * @param height  the expected image height
+     * @param scale   1, 2, 4 or 8, decode at 1/scale of the size in the DCT domain
+     * @return false if the image is corrupt or does not match the expected size, the
+     *         content of data should be dropped then
+     */
+    bool decode(const uchar* jpeg, unsigned long size, uchar* data, int width, int pitch, int height, int scale = 1);
+
+    /** @brief The size of one dimension decoded at 1/scale
+     */
+    static int getScaledSize(int size, int scale) { return (size + scale - 1) / scale; }
+
+    /** @brief The cheapest scale that still decodes at least the target size
+     * Decoding at 1/2, 1/4 or 1/8 skips most of the IDCT work, the image is then resized by
+     * at most a factor of two to the target, instead of from the full size.
+     * @return 1, 2, 4 or 8
+     */
+    static int chooseScale(int width, int height, int target_width, int target_height);
+
+    /** @brief Drop the cached header, the next frame will be parsed again
+     */
+    void reset() { has_header = false; }
+
+    /** @brief Whether frames are decoded to BGR
+     */
+    bool isBGR() const { return bgr; }
+
+    /** @brief The number of frames failed to decode so far
+     */
+    uint getErrorCount() const { return error_count; }
+
+private:
+    bool parseHeader(const uchar* jpeg, unsigned long size);
+
+private:
+    void   *handle;         // tjhandle of the decompressor
+    bool    bgr;            // TJPF_BGR instead of TJPF_RGB
+    bool    has_header;     // whether the header below is cached
+    int     width;          // cached image width
+    int     height;         // cached image height
+    int     subsamp;        // cached chroma subsampling
+    uint    error_count;
+};
+#endif  // JPEG_DECODER_H
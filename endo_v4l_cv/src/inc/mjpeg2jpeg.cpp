@@ -80,3 +80,29 @@ bool mjpeg2jpeg(const byte *in, const unsigned int in_size, byte *out, unsigned
     return true;
 }
 
+
+
+bool hasHuffmanTable(const byte *in, unsigned int in_size)
+{
+    // walk the marker segments from SOI up to SOS, each one is 0xff, marker, 2-byte length
+    unsigned int ptr = 2;
+    while(ptr + 4 <= in_size)
+    {
+        if(in[ptr] != 0xff)
+            return false;
+        byte marker = in[ptr + 1];
+        if(marker == 0xc4)
+            return true;
+        if(marker == 0xda)  // SOS, the entropy-coded data follows
+            return false;
+        ptr += 2 + ((in[ptr + 2] << 8) | in[ptr + 3]);
+    }
+    return false;
+}
+
+
+const byte* getHuffmanTable(unsigned int *size)
+{
+    *size = sizeof(JPGDHTSeg);
+    return JPGDHTSeg;
+}
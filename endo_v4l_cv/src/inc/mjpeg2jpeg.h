@@ -5,4 +5,10 @@ using byte = unsigned char;
 
 bool mjpeg2jpeg(const byte *in, const unsigned int in_size, byte *out, unsigned int out_limit_size, unsigned int *out_size);
 
+/* Whether the frame carries its own DHT segment, only the markers before the scan are read */
+bool hasHuffmanTable(const byte *in, unsigned int in_size);
+
+/* The standard DHT segment that most UVC cameras omit from their MJPEG frames */
+const byte* getHuffmanTable(unsigned int *size);
+
 #endif // MJPEG2JPEG_H
@@ -1,13 +1,13 @@
 #include "v4l2_capture.h"
-#include "mjpeg2jpeg.h"
-#include <poll.h>
-#include <turbojpeg.h>
+#include "yuv_convert.h"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
-#define MJPG_FORMAT_VALUE 1196444237
-#define YUYV_FORMAT_VALUE 1448695129
 
 /*
 VIDIOC_QUERYCAP     check the properties of the device
@@ -30,6 +30,24 @@ namespace
         // exit(EXIT_FAILURE);
     }
 
+    /* The probed properties of a device, they do not change while it stays plugged in, so
+       reopening it (retries, setFPS, another capture of the same camera) skips the probe. */
+    struct DeviceProbe
+    {
+        std::vector<uint32_t> pixel_formats;
+        std::map<uint32_t, std::vector<V4L2Capture::Mode>> modes;   // by pixel format
+    };
+    std::map<std::string, DeviceProbe> probe_cache;  // by card name and bus info
+    std::mutex probe_mtx;
+
+    long elapsedMs(std::chrono::steady_clock::time_point& since)
+    {
+        auto now = std::chrono::steady_clock::now();
+        long ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - since).count();
+        since = now;
+        return ms;
+    }
+
     int xioctl(int fh, unsigned long int request, void *arg)
     {
         int r;
@@ -38,69 +56,40 @@ namespace
         }while( r == -1 && EINTR == errno); // meets error or interrupted system call
         return r;
     }
-
-    static bool V4L2Capture_deviceHandlePoll(const std::vector<int> &device_handles, std::vector<int> &ready, int64_t timeout_ms)
-    {
-        const size_t N = device_handles.size();
-
-        ready.clear();
-        ready.reserve(N);
-
-        const auto poll_flags = POLLIN | POLLRDNORM | POLLERR;
-
-        std::vector<pollfd> fds;
-        fds.reserve(N);
-
-        for(size_t i = 0; i < N; i++)
-        {
-            int hd = device_handles[i];
-            fds.push_back(pollfd{hd, poll_flags, 0});
-        }
-
-        int64_t timeoutMs = -1;
-        if(timeout_ms > 0)
-            timeoutMs = timeout_ms;
-
-        int ret = poll(fds.data(), N, timeoutMs);
-        if(ret == -1)
-            return false;
-        if(ret == 0)
-            return 0;
-        for(size_t i = 0; i < N; ++i)
-        {
-            const auto &fd = fds[i];
-            if((fd.revents & (POLLIN | POLLRDNORM)) != 0 )
-                ready.push_back(i);
-            else if((fd.revents & POLLERR) != 0)
-                std::cout << "Error is reported for camera stream: " << i << ", handle " << device_handles[i] << std::endl;
-            else {
-                // not ready
-            }
-        }
-        return true;
-    }
 }
 
-V4L2Capture::V4L2Capture(uint width, uint height, uint buffer_count/* = 3 */)
+V4L2Capture::V4L2Capture(uint width, uint height, uint buffer_count/* = 3 */, StreamMode mode/* = STREAM_MJPEG */, bool bgr/* = false */)
     : cameraFd(-1)
     , buffer_mmap_ptr(nullptr)
-    , decode_buffer(nullptr)
+    , copied_bytes(0)
+    , decoder(bgr)
+    , latest_only(false)
+    , skipped_frames(0)
+    , last_sequence(0)
+    , last_timestamp_us(0)
     , buffer_count(buffer_count)
+    , requested_width(width)
+    , requested_height(height)
     , frame_width(width)
     , frame_height(height)
-    , fps(60)
+    , interval_num(1)
+    , interval_den(60)
+    , mode_policy(MODE_REQUESTED)
     , sharpness(3)
+    , stream_mode(mode)
+    , pixel_format(0)
+    , bytes_per_line(0)
+    , probe_cached(false)
+    , mode_kept(true)
+    , startup_ms(0)
+    , first_frame_ms(-1)
 {
-    decode_buffer = new uchar[frame_width * frame_height * 3];
-    jpeg_buffer = new uchar[frame_width * frame_height * 3];
     CLEAR(device_name);
 }
 
 V4L2Capture::~V4L2Capture()
 {
     closeDevice();
-    delete [] decode_buffer;
-    delete [] jpeg_buffer;
 }
 
 bool V4L2Capture::openDevice(int index)
@@ -114,27 +103,57 @@ bool V4L2Capture::openDevice(int index)
     return initDevice(device_name);
 }
 
+void V4L2Capture::openReplay(uint pixel_format, uint bytes_per_line)
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    resetDevice();
+    decoder.reset();
+    this->pixel_format = pixel_format;
+    this->bytes_per_line = bytes_per_line;
+    CLEAR(device_name);
+    sprintf(device_name, "replay");
+}
+
 bool V4L2Capture::initDevice(const char* device_name)
 {
     std::lock_guard<std::mutex> lck(mtx);
+    auto start = std::chrono::steady_clock::now();
+    auto phase = start;
     if(!openDevice(device_name))
         return false;
+    decoder.reset();
+    long open_ms = elapsedMs(phase);
 
     // check the basis information (selected do)
     ioctlQueryCapability();
     if(!ioctlEnumFmt())
         return false;
+    ioctlNegotiateMode();
+    long probe_ms = elapsedMs(phase);
 
-    // set some parameters and format for capturing (must do)
+    // set some parameters and format for capturing (must do), each is skipped when the
+    // device already runs with the wanted value. The format goes first, S_FMT resets a
+    // UVC device to the default interval of the frame size, so the interval set before it
+    // would be lost and the one read back by G_PARM would not be the running one.
     ioctlSetSharpnessParm();
-    ioctlSetStreamParm();
     ioctlSetStreamFmt();
+    ioctlSetStreamParm();
+    long mode_ms = elapsedMs(phase);
     // aplly buffer room and do the process (must do)
     ioctlRequestBuffers();
     ioctlMmapBuffers();
     ioctlQueueBuffers();
+    long buffer_ms = elapsedMs(phase);
     ioctlSetStreamSwitch(true);
-
+    long stream_ms = elapsedMs(phase);
+
+    startup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(phase - start).count();
+    stream_on_time = phase;
+    first_frame_ms = -1;
+    std::cout << device_name << " is up in " << startup_ms << " ms: open " << open_ms
+              << ", probe " << probe_ms << (probe_cached ? " (cached)" : "")
+              << ", mode " << mode_ms << (mode_kept ? " (kept)" : "")
+              << ", buffers " << buffer_ms << ", stream on " << stream_ms << std::endl;
     return true;
 }
 
@@ -158,7 +177,8 @@ bool V4L2Capture::openDevice(const char* device_name)
 
     resetDevice();
     // open the device and return a new file descriptor for it, or -1 on error.
-    cameraFd = open(device_name, O_RDWR, 0); // | O_NONBLOCK
+    // non-blocking in latest-only mode, so that the queue can be drained until EAGAIN
+    cameraFd = open(device_name, O_RDWR | (latest_only ? O_NONBLOCK : 0), 0);
     if(cameraFd == -1)
     {
         std::cout<< "Cannot open device: " << device_name << ", " << errno << ", " << strerror(errno) << std::endl;
@@ -178,6 +198,7 @@ void V4L2Capture::closeDevice()
 void V4L2Capture::ioctlQueryCapability()
 {
     v4l2_capability cap;
+    CLEAR(cap);
     if(xioctl(cameraFd, VIDIOC_QUERYCAP, &cap) == -1)
     {
         if(errno == EINVAL)
@@ -201,6 +222,10 @@ void V4L2Capture::ioctlQueryCapability()
         std::cout << "Does not support streaming.\n";
         // exit(EXIT_FAILURE);
     }
+
+    // the key of the probe cache, the bus info tells two cameras of the same model apart
+    probe_key = std::string(reinterpret_cast<const char*>(cap.card)) + "@"
+              + reinterpret_cast<const char*>(cap.bus_info);
 }
 
 void V4L2Capture::ioctlQueryStd()
@@ -221,21 +246,157 @@ bool V4L2Capture::ioctlEnumFmt()
     __u32		    reserved[4];
     };*/
 
-    v4l2_fmtdesc fmtdesc;
-    fmtdesc.index = 0;
-    fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    std::vector<uint32_t> pixel_formats;
+    {
+        std::lock_guard<std::mutex> lck(probe_mtx);
+        auto it = probe_cache.find(probe_key);
+        probe_cached = it != probe_cache.end();
+        if(probe_cached)
+            pixel_formats = it->second.pixel_formats;
+    }
 
-    bool support_mjpg = false;
-    // display all the supported format
-    std::cout << "Support Format: \n";
-    while(ioctl(cameraFd, VIDIOC_ENUM_FMT, &fmtdesc) != -1)
+    if(!probe_cached)
     {
-        std::cout << "flags=" << fmtdesc.flags << "\tdescription=" << fmtdesc.description << "\tpixel format=" << char(fmtdesc.pixelformat&0xFF) << char((fmtdesc.pixelformat>>8)&0xFF) << char((fmtdesc.pixelformat>>16)&0xFF) << char((fmtdesc.pixelformat>>24)&0xFF) << std::endl;
-        fmtdesc.index++;
+        v4l2_fmtdesc fmtdesc;
+        CLEAR(fmtdesc);
+        fmtdesc.index = 0;
+        fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        // display all the supported format
+        std::cout << "Support Format: \n";
+        while(ioctl(cameraFd, VIDIOC_ENUM_FMT, &fmtdesc) != -1)
+        {
+            std::cout << "flags=" << fmtdesc.flags << "\tdescription=" << fmtdesc.description << "\tpixel format=" << char(fmtdesc.pixelformat&0xFF) << char((fmtdesc.pixelformat>>8)&0xFF) << char((fmtdesc.pixelformat>>16)&0xFF) << char((fmtdesc.pixelformat>>24)&0xFF) << std::endl;
+            fmtdesc.index++;
+            pixel_formats.push_back(fmtdesc.pixelformat);
+        }
 
-        support_mjpg = support_mjpg || (fmtdesc.pixelformat == MJPG_FORMAT_VALUE);
+        std::lock_guard<std::mutex> lck(probe_mtx);
+        probe_cache[probe_key].pixel_formats = pixel_formats;
     }
-    return support_mjpg;
+
+    bool support_mjpg = false, support_yuyv = false, support_nv12 = false;
+    for(uint32_t format : pixel_formats)
+    {
+        support_mjpg = support_mjpg || (format == V4L2_PIX_FMT_MJPEG);
+        support_yuyv = support_yuyv || (format == V4L2_PIX_FMT_YUYV);
+        support_nv12 = support_nv12 || (format == V4L2_PIX_FMT_NV12);
+    }
+
+    // the raw mode takes YUYV first, it is what UVC cameras offer at most resolutions
+    if(stream_mode == STREAM_MJPEG)
+        pixel_format = support_mjpg ? V4L2_PIX_FMT_MJPEG : 0;
+    else
+        pixel_format = support_yuyv ? V4L2_PIX_FMT_YUYV : (support_nv12 ? V4L2_PIX_FMT_NV12 : 0);
+
+    if(pixel_format == 0)
+        std::cout << device_name << " supports no " << (stream_mode == STREAM_MJPEG ? "MJPEG" : "YUYV/NV12") << " format\n";
+    return pixel_format != 0;
+}
+
+void V4L2Capture::ioctlNegotiateMode()
+{
+    {
+        std::lock_guard<std::mutex> lck(probe_mtx);
+        auto& cached = probe_cache[probe_key].modes;
+        auto it = cached.find(pixel_format);
+        if(it != cached.end())
+            modes = it->second;
+        else
+            modes.clear();
+    }
+    if(modes.empty())
+    {
+        modes = ioctlEnumModes();
+        std::lock_guard<std::mutex> lck(probe_mtx);
+        probe_cache[probe_key].modes[pixel_format] = modes;
+    }
+
+    frame_width = requested_width;
+    frame_height = requested_height;
+    if(mode_policy == MODE_REQUESTED || modes.empty())
+        return;
+
+    // the frame rate decides, a smaller frame costs less bandwidth and decode time at
+    // the same rate
+    const Mode* best = nullptr;
+    for(const Mode& mode : modes)
+    {
+        if(mode.interval_num == 0)
+            continue;
+        if(mode_policy == MODE_MAX_FPS && (mode.width < requested_width || mode.height < requested_height))
+            continue;
+        uint64_t rate = uint64_t(mode.interval_den) * (best ? best->interval_num : 0);
+        uint64_t best_rate = best ? uint64_t(best->interval_den) * mode.interval_num : 0;
+        if(!best || rate > best_rate
+           || (rate == best_rate && mode.width * mode.height < best->width * best->height))
+            best = &mode;
+    }
+    if(!best)
+    {
+        std::cout << device_name << " offers no mode at or above " << requested_width << "x"
+                  << requested_height << ", the requested one is set\n";
+        return;
+    }
+
+    frame_width = best->width;
+    frame_height = best->height;
+    interval_num = best->interval_num;
+    interval_den = best->interval_den;
+    std::cout << device_name << " negotiated " << frame_width << "x" << frame_height << " at "
+              << best->getFPS() << " fps out of " << modes.size() << " modes\n";
+}
+
+std::vector<V4L2Capture::Mode> V4L2Capture::ioctlEnumModes()
+{
+    std::vector<Mode> sizes;
+    v4l2_frmsizeenum frmsize;
+    CLEAR(frmsize);
+    frmsize.pixel_format = pixel_format;
+    for(frmsize.index = 0; ioctl(cameraFd, VIDIOC_ENUM_FRAMESIZES, &frmsize) != -1; frmsize.index++)
+    {
+        if(frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE)
+        {
+            sizes.push_back(Mode{frmsize.discrete.width, frmsize.discrete.height, 0, 0});
+            continue;
+        }
+        // a stepwise range is the only entry, it offers the requested size if anything
+        const v4l2_frmsize_stepwise& range = frmsize.stepwise;
+        uint step_width = std::max(range.step_width, 1u);
+        uint step_height = std::max(range.step_height, 1u);
+        uint width = std::min(std::max(requested_width, range.min_width), range.max_width);
+        uint height = std::min(std::max(requested_height, range.min_height), range.max_height);
+        width = range.min_width + (width - range.min_width) / step_width * step_width;
+        height = range.min_height + (height - range.min_height) / step_height * step_height;
+        sizes.push_back(Mode{width, height, 0, 0});
+        break;
+    }
+
+    std::vector<Mode> modes;
+    for(const Mode& size : sizes)
+    {
+        v4l2_frmivalenum frmival;
+        CLEAR(frmival);
+        frmival.pixel_format = pixel_format;
+        frmival.width = size.width;
+        frmival.height = size.height;
+        size_t count = modes.size();
+        for(frmival.index = 0; ioctl(cameraFd, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) != -1; frmival.index++)
+        {
+            if(frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE)
+            {
+                modes.push_back(Mode{size.width, size.height, frmival.discrete.numerator, frmival.discrete.denominator});
+                continue;
+            }
+            // the shortest interval of a stepwise range
+            modes.push_back(Mode{size.width, size.height, frmival.stepwise.min.numerator, frmival.stepwise.min.denominator});
+            break;
+        }
+        // drivers without interval enumeration run the size at the requested rate
+        if(modes.size() == count)
+            modes.push_back(Mode{size.width, size.height, interval_num, interval_den});
+    }
+    return modes;
 }
 
 void V4L2Capture::ioctlSetStreamParm()
@@ -244,17 +405,33 @@ void V4L2Capture::ioctlSetStreamParm()
     memset(&streamparm, 0, sizeof(streamparm));
     streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
+    // S_PARM makes UVC devices renegotiate the stream, which is the slow part, so it is
+    // only sent when the interval the device runs after S_FMT differs
+    if(ioctl(cameraFd, VIDIOC_G_PARM, &streamparm) != -1
+       && uint64_t(streamparm.parm.capture.timeperframe.numerator) * interval_den
+          == uint64_t(streamparm.parm.capture.timeperframe.denominator) * interval_num)
+    {
+        return;
+    }
+    mode_kept = false;
+    memset(&streamparm, 0, sizeof(streamparm));
+    streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
     // capture mode: when a qualitfied image is required, mode set to 1, otherwise set to 0
     streamparm.parm.capture.capturemode = 0;
 
     /* set the fps. The parameters set here is a nominal value, the actual fps is depend on
        the device */
-    streamparm.parm.capture.timeperframe.numerator = 1;
-    streamparm.parm.capture.timeperframe.denominator = this->fps;
+    streamparm.parm.capture.timeperframe.numerator = interval_num;
+    streamparm.parm.capture.timeperframe.denominator = interval_den;
     ioctl(cameraFd, VIDIOC_S_PARM, &streamparm);
 
     // get the set fps
-    ioctl(cameraFd, VIDIOC_G_PARM, &streamparm);
+    if(ioctl(cameraFd, VIDIOC_G_PARM, &streamparm) != -1 && streamparm.parm.capture.timeperframe.numerator > 0)
+    {
+        interval_num = streamparm.parm.capture.timeperframe.numerator;
+        interval_den = streamparm.parm.capture.timeperframe.denominator;
+    }
     std::cout << "Capture Mode: " << streamparm.parm.capture.capturemode << "\nFrame Rate: " << streamparm.parm.capture.timeperframe.numerator << "/" << streamparm.parm.capture.timeperframe.denominator << std::endl;
 }
 
@@ -267,30 +444,45 @@ void V4L2Capture::ioctlSetStreamFmt()
 
     if(xioctl(cameraFd, VIDIOC_G_FMT, &format) == -1)
         errno_exit("VIDIOC_G_FMT");
-    if(format.fmt.pix.pixelformat != V4L2_PIX_FMT_JPEG)
-        std::cout << "Not using MJPEG as data format\n";
 
-    // set/change the format
-    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    format.fmt.pix.width = frame_width;        // a value should be divide by 16
-    format.fmt.pix.height = frame_height;      // a value should be divide by 16
-    format.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
-    format.fmt.pix.field = V4L2_FIELD_ANY; // not sure whether need to set
+    // the device keeps its format between opens, nothing to set then
+    if(format.fmt.pix.width != frame_width || format.fmt.pix.height != frame_height
+       || format.fmt.pix.pixelformat != pixel_format)
+    {
+        mode_kept = false;
+
+        // set/change the format
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        format.fmt.pix.width = frame_width;        // a value should be divide by 16
+        format.fmt.pix.height = frame_height;      // a value should be divide by 16
+        format.fmt.pix.pixelformat = pixel_format;
+        format.fmt.pix.field = V4L2_FIELD_ANY; // not sure whether need to set
+
+        if(xioctl(cameraFd, VIDIOC_S_FMT, &format) == -1)
+            errno_exit("VIDIOC_S_FMT");
+        if(format.fmt.pix.pixelformat != pixel_format)
+            errno_exit("VIDIOC_S_FMT: Unable to set the pixel format");
+
+        // the frames come in the size the driver adjusted to, not the requested one
+        if(format.fmt.pix.width != frame_width || format.fmt.pix.height != frame_height)
+        {
+            std::cout << "Device reset " << frame_width << "x" << frame_height << " to "
+                      << format.fmt.pix.width << "x" << format.fmt.pix.height << std::endl;
+            frame_width = format.fmt.pix.width;
+            frame_height = format.fmt.pix.height;
+        }
+    }
 
-    if(xioctl(cameraFd, VIDIOC_S_FMT, &format) == -1)
-        errno_exit("VIDIOC_S_FMT");
-    if(format.fmt.pix.width != frame_width)
-        std::cout << "Device reset width to " << frame_width << std::endl;
-    if(format.fmt.pix.height != frame_height)
-        std::cout << "Device reset height to " << frame_height << std::endl;
-    if(format.fmt.pix.pixelformat != V4L2_PIX_FMT_MJPEG)
-        errno_exit("VIDIOC_S_FMT: Unable to set V4L2_PIX_FMT_MJPEG");
+    // raw rows may be padded by the driver
+    bytes_per_line = format.fmt.pix.bytesperline;
 }
 
 void V4L2Capture::ioctlSetSharpnessParm()
 {
     v4l2_control ctrl = v4l2_control();
     ctrl.id = V4L2_CID_SHARPNESS;
+    if(ioctl(cameraFd, VIDIOC_G_CTRL, &ctrl) != -1 && ctrl.value == static_cast<int>(this->sharpness))
+        return;
     ctrl.value = static_cast<int>(this->sharpness);
     tryIoctl(VIDIOC_S_CTRL, &ctrl);
 }
@@ -352,9 +544,11 @@ void V4L2Capture::ioctlQueueBuffers()
     }
 }
 
-bool V4L2Capture::ioctlDequeueBuffers(unsigned char* data)
+bool V4L2Capture::ioctlDequeueBuffers(unsigned char* data, int pitch/* = 0 */, bool* is_corrupt/* = nullptr */)
 {
     std::lock_guard<std::mutex> lck(mtx);
+    if(is_corrupt)
+        *is_corrupt = false;
     if(cameraFd < 0)
         return false;
 
@@ -397,6 +591,58 @@ bool V4L2Capture::ioctlDequeueBuffers(unsigned char* data)
         return false;
 
     v4l2_buffer vbuffer;
+    if(!(latest_only ? dequeueLatest(vbuffer) : dequeue(vbuffer)))
+        return false;
+    last_sequence = vbuffer.sequence;
+    last_timestamp_us = getTimestampUs(vbuffer);
+
+    bool decompress_mjpeg_success = decodeBuffer(vbuffer, data, pitch);
+
+    // put the buffer room back to queue to achieve a loop for data capturing
+    queue(vbuffer);
+
+    if(is_corrupt)
+        *is_corrupt = !decompress_mjpeg_success;
+    return decompress_mjpeg_success;
+}
+
+bool V4L2Capture::dequeueBuffer(v4l2_buffer& vbuffer)
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    if(cameraFd < 0)
+        return false;
+    return latest_only ? dequeueLatest(vbuffer) : dequeue(vbuffer);
+}
+
+bool V4L2Capture::queueBuffer(const v4l2_buffer& vbuffer)
+{
+    std::lock_guard<std::mutex> lck(mtx);
+    if(cameraFd < 0)
+        return false;
+    return queue(vbuffer);
+}
+
+bool V4L2Capture::decodeBuffer(const v4l2_buffer& vbuffer, unsigned char* data, int pitch/* = 0 */)
+{
+    if(vbuffer.bytesused == 0 || vbuffer.index >= buffer_count)
+        return false;
+
+    //GET_CURRENT_TIME(start);
+    // only the first bytesused bytes of the mapped buffer hold the payload
+    return processImage(buffer_mmap_ptr[vbuffer.index].addr, vbuffer.bytesused, data, pitch);
+    //GET_CURRENT_TIME(end);
+    //decompress_time = ::std::chrono::duration_cast<::std::chrono::milliseconds>(end - start).count();
+}
+
+bool V4L2Capture::decodePayload(const void* payload, uint size, unsigned char* data, int pitch/* = 0 */)
+{
+    if(size == 0 || pixel_format == 0)
+        return false;
+    return processImage(payload, size, data, pitch);
+}
+
+bool V4L2Capture::dequeue(v4l2_buffer& vbuffer)
+{
     CLEAR(vbuffer);
     vbuffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     vbuffer.memory = V4L2_MEMORY_MMAP;
@@ -407,28 +653,49 @@ bool V4L2Capture::ioctlDequeueBuffers(unsigned char* data)
         switch(errno)
         {
         case EAGAIN:
+            // nothing filled yet on a non-blocking device
+            return false;
         case EIO:
         default:
             errno_exit("VIDIOC_DQBUF");
             return false;
         }
     }
-
-    bool decompress_mjpeg_success = false;
-    if(vbuffer.length > 0)
+    if(first_frame_ms < 0)
     {
-        //GET_CURRENT_TIME(start);
-        decompress_mjpeg_success = processImage(buffer_mmap_ptr[vbuffer.index].addr, vbuffer.length, data);
-
-        //GET_CURRENT_TIME(end);
-        //decompress_time = ::std::chrono::duration_cast<::std::chrono::milliseconds>(end - start).count();
+        first_frame_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - stream_on_time).count();
+        std::cout << device_name << ": first frame " << first_frame_ms << " ms after stream on, "
+                  << startup_ms + first_frame_ms << " ms after open\n";
     }
+    return true;
+}
 
-    // put the buffer room back to queue to achieve a loop for data capturing
-    if(xioctl(cameraFd, VIDIOC_QBUF, &vbuffer) == -1)
-        errno_exit("VIDIOC_DBUF");
+bool V4L2Capture::dequeueLatest(v4l2_buffer& vbuffer)
+{
+    if(!dequeue(vbuffer))
+        return false;
 
-    return decompress_mjpeg_success;
+    // every further filled buffer is newer, the one held so far goes back undecoded
+    v4l2_buffer newer;
+    while(dequeue(newer))
+    {
+        queue(vbuffer);
+        vbuffer = newer;
+        skipped_frames++;
+    }
+    return true;
+}
+
+bool V4L2Capture::queue(const v4l2_buffer& vbuffer)
+{
+    v4l2_buffer qbuffer = vbuffer;
+    if(xioctl(cameraFd, VIDIOC_QBUF, &qbuffer) == -1)
+    {
+        errno_exit("VIDIOC_QBUF");
+        return false;
+    }
+    return true;
 }
 
 void V4L2Capture::ioctlSetStreamSwitch(bool on)
@@ -453,44 +720,45 @@ void V4L2Capture::unMmapBuffers()
         munmap(buffer_mmap_ptr[i].addr, buffer_mmap_ptr[i].length);
 }
 
-bool V4L2Capture::processImage(const void *p, uint size, unsigned char* data)
+bool V4L2Capture::processImage(const void *p, uint size, unsigned char* data, int pitch)
 {
-    unsigned int jpg_size = 0;
-
-    bool bSuccess = mjpeg2jpeg(static_cast<const byte*>(p), size, jpeg_buffer, frame_width*frame_height * 3, &jpg_size);
+    if(pixel_format != V4L2_PIX_FMT_MJPEG)
+        return convertRaw(static_cast<const uchar*>(p), size, data, pitch);
 
-    if(!bSuccess)
-    {
-        std::cout << "mjpeg2jpeg failed!\n";
-        return false;
-    }
-    bSuccess = decodeJPEG(jpeg_buffer, jpg_size);
+    /* The MJPEG payload omits the DHT segment, libjpeg-turbo falls back to the standard
+       Huffman tables in that case, so the mapped buffer is decoded as it is and the pixels
+       are written straight into the caller's frame. */
+    bool bSuccess = decodeJPEG(static_cast<const uchar*>(p), size, data, pitch);
     if(bSuccess)
-    {
-        memcpy(data, decode_buffer, frame_height*frame_width*3*sizeof(unsigned char));
-    }
-    else std::cout << "Jpeg decompression failed!\n";
+        copied_bytes = 0;
 
     return bSuccess;
 }
 
 
-bool V4L2Capture::waitAny(const std::vector<int> &camera_fds, std::vector<int> &ready_index, int64_t timeout_ms)
+bool V4L2Capture::convertRaw(const uchar *praw_image, uint size, uchar *data, int pitch)
 {
-    return V4L2Capture_deviceHandlePoll(camera_fds, ready_index, timeout_ms);
+    uint src_pitch = bytes_per_line > 0 ? bytes_per_line : frame_width * (pixel_format == V4L2_PIX_FMT_YUYV ? 2 : 1);
+    uint expected = pixel_format == V4L2_PIX_FMT_YUYV ? src_pitch * frame_height : src_pitch * frame_height * 3 / 2;
+    if(size < expected)
+    {
+        std::cout << device_name << ": short raw frame, " << size << " of " << expected << " bytes\n";
+        return false;
+    }
+
+    if(pitch == 0)
+        pitch = frame_width * 3;
+    if(pixel_format == V4L2_PIX_FMT_YUYV)
+        yuyv2rgb(praw_image, src_pitch, data, pitch, frame_width, frame_height, decoder.isBGR());
+    else
+        nv122rgb(praw_image, src_pitch, praw_image + src_pitch * frame_height, src_pitch, data, pitch, frame_width, frame_height, decoder.isBGR());
+    copied_bytes = 0;
+    return true;
 }
 
-bool V4L2Capture::decodeJPEG(uchar *pcompressed_image, unsigned long jpeg_size)
+bool V4L2Capture::decodeJPEG(const uchar *pcompressed_image, unsigned long jpeg_size, uchar *data, int pitch)
 {
-    int width, height, jpeg_sub_samp;
-    tjhandle jpeg_decompressor = tjInitDecompress();
-    tjDecompressHeader2(jpeg_decompressor, pcompressed_image, jpeg_size, &width, &height, &jpeg_sub_samp);
-
-    tjDecompress2(jpeg_decompressor, pcompressed_image, jpeg_size, decode_buffer, width, 0/*pitch*/, height, TJPF_RGB, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
-
-    tjDestroy(jpeg_decompressor);
-
-    return true;
+    return decoder.decode(pcompressed_image, jpeg_size, data, frame_width, pitch, frame_height);
 }
 
 void V4L2Capture::resetDevice()
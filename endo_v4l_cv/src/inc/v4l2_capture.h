@@ -9,10 +9,15 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <linux/videodev2.h> // the header of class V4L2
 #include <memory>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "jpeg_decoder.h"
 
 
 /** @brief This class is designed for video capture.
@@ -23,8 +28,40 @@ class V4L2Capture
     using uint = unsigned int;
     using uchar = unsigned char;
 public:
+    /** @brief The kind of stream requested from the device
+     */
+    enum StreamMode
+    {
+        STREAM_MJPEG,   // compressed by the camera, decoded by libjpeg-turbo
+        STREAM_RAW,     // YUYV or NV12, whichever the device offers, skips the camera encoder
+    };
+
+    /** @brief How the frame size and rate are chosen among the modes the device enumerates
+     */
+    enum ModePolicy
+    {
+        MODE_REQUESTED,     // the requested size and rate (60 fps unless set by setMode()), as far as the driver accepts them
+        MODE_MAX_FPS,       // the highest fps at or above the requested size, the smallest such size
+        MODE_MIN_LATENCY,   // the shortest frame interval of any size, the smallest such size
+    };
+
+    /** @brief A frame size and interval offered by the device for the negotiated pixel format
+     */
+    struct Mode
+    {
+        uint width;
+        uint height;
+        uint interval_num;  // the frame interval in seconds is interval_num / interval_den
+        uint interval_den;
+
+        double getFPS() const { return interval_num > 0 ? double(interval_den) / interval_num : 0; }
+    };
+
     /* Functions relevent to video capture */
-    explicit V4L2Capture(uint width, uint height, uint buffer_count = 3);
+    /** @param bgr  deliver frames as BGR instead of RGB, decoders and converters write the
+     *              channel order directly
+     */
+    explicit V4L2Capture(uint width, uint height, uint buffer_count = 3, StreamMode mode = STREAM_MJPEG, bool bgr = false);
     ~V4L2Capture();
 
     /** @brief Open the video device
@@ -32,6 +69,47 @@ public:
      * @return true/false
      */
     bool openDevice(int index);
+
+    /** @brief Deliver only the newest frame, to be set before openDevice()
+     * The device is opened non-blocking and every dequeue drains all filled buffers, the
+     * older ones go back to the driver undecoded and are counted by getSkippedFrames().
+     * This trades frames for latency, a frame is never older than one period when it is
+     * decoded.
+     */
+    void setLatestOnly(bool on) { latest_only = on; }
+
+    bool isLatestOnly() const { return latest_only; }
+
+    /** @brief Choose the mode by the policy, to be set before openDevice()
+     * The width and height given to the constructor are the lower bound of MODE_MAX_FPS.
+     * The negotiated mode is read back by getWidth(), getHeight() and getFPS(), every
+     * buffer the frames are decoded to must be sized from them.
+     */
+    void setModePolicy(ModePolicy policy) { mode_policy = policy; }
+
+    /** @brief Run exactly this mode, e.g. the one another camera negotiated, to be set
+     * before openDevice()
+     * The size and the frame interval are taken as they are, the policy becomes MODE_REQUESTED.
+     */
+    void setMode(const Mode& mode)
+    {
+        requested_width = mode.width;
+        requested_height = mode.height;
+        interval_num = mode.interval_num;
+        interval_den = mode.interval_den;
+        mode_policy = MODE_REQUESTED;
+    }
+
+    /** @brief The negotiated mode, the requested one before openDevice()
+     */
+    Mode getMode() const { return Mode{frame_width, frame_height, interval_num, interval_den}; }
+
+    /** @brief Take the stream format of a recorded device instead of opening one
+     * Only decodePayload() is usable afterwards, for replaying a capture dump.
+     * @param pixel_format    the V4L2_PIX_FMT_* the device negotiated
+     * @param bytes_per_line  the row pitch of raw frames, 0 for MJPEG
+     */
+    void openReplay(uint pixel_format, uint bytes_per_line);
 private:
     /** @brief Initializing the device before video capture
      */
@@ -61,14 +139,23 @@ private:
     void ioctlQueryStd();
 
     /** @brief Display the supported frame format (v4l2_fmtdesc)
-     * In this fucntion, it checks the supported capturing frame format.
+     * In this fucntion, it checks the supported capturing frame format, and negotiates the
+     * pixel format for the stream mode.
      */
     bool ioctlEnumFmt();
 
+    /** @brief Enumerate the frame sizes (v4l2_frmsizeenum) and frame intervals
+     * (v4l2_frmivalenum) of the pixel format, and pick the mode by the policy.
+     * A stepwise or continuous range contributes the requested size clamped into it.
+     */
+    void ioctlNegotiateMode();
+    std::vector<Mode> ioctlEnumModes();
+
     /** @brief Set the parameters (v4l2_streamparm) of video streaming.
      * In this function, the capture mode and fps of the input video streaming are set.
      * Note, this process is time-consuming. However, if unset the parameters, it might cannot
      * capture normal image.
+     * To be called after ioctlSetStreamFmt(), S_FMT resets the interval of UVC devices.
      */
     void ioctlSetStreamParm();
 
@@ -95,8 +182,112 @@ private:
     void ioctlQueueBuffers();
 public:
     /** @brief Get frame from output queue
+     * The frame is decoded from the mapped buffer straight into data.
+     * @param data   the destination RGB/BGR frame, at least frame_width x frame_height x 3
+     * @param pitch  bytes per row of data, 0 for a continuous frame
+     * @param is_corrupt set when a frame was dequeued but could not be decoded, so the
+     *                   caller can tell a lost frame from a failing device
      */
-    bool ioctlDequeueBuffers(unsigned char* data);
+    bool ioctlDequeueBuffers(unsigned char* data, int pitch = 0, bool* is_corrupt = nullptr);
+
+    /** @brief Dequeue a filled buffer without waiting, for callers that watch getFd()
+     * In latest-only mode this is the newest of the filled buffers.
+     * The buffer must be given back by queueBuffer() once its payload is consumed.
+     */
+    bool dequeueBuffer(v4l2_buffer& vbuffer);
+
+    /** @brief Give a buffer from dequeueBuffer() back to the driver
+     */
+    bool queueBuffer(const v4l2_buffer& vbuffer);
+
+    /** @brief Decode the payload of a dequeued buffer into data
+     * @param vbuffer the buffer from dequeueBuffer(), still owned by the caller
+     * @param data    the destination RGB/BGR frame, at least frame_width x frame_height x 3
+     * @param pitch   bytes per row of data, 0 for a continuous frame
+     */
+    bool decodeBuffer(const v4l2_buffer& vbuffer, unsigned char* data, int pitch = 0);
+
+    /** @brief Decode a payload of the negotiated format, the same path as decodeBuffer()
+     * @param payload  the bytesused bytes of a buffer, e.g. read back from a capture dump
+     */
+    bool decodePayload(const void* payload, uint size, unsigned char* data, int pitch = 0);
+
+    /** @brief The kernel timestamp of a dequeued buffer in microseconds
+     * UVC devices stamp buffers with CLOCK_MONOTONIC, so the timestamps of different
+     * cameras are comparable.
+     */
+    static int64_t getTimestampUs(const v4l2_buffer& vbuffer)
+    {
+        return int64_t(vbuffer.timestamp.tv_sec) * 1000000 + vbuffer.timestamp.tv_usec;
+    }
+
+    /** @brief The sequence number of the latest frame from ioctlDequeueBuffers()
+     */
+    uint getSequence() const { return last_sequence; }
+
+    /** @brief The kernel timestamp of the latest frame from ioctlDequeueBuffers()
+     */
+    int64_t getTimestampUs() const { return last_timestamp_us; }
+
+    /** @brief The payload of a dequeued buffer, vbuffer.bytesused bytes long
+     * Valid until the buffer is given back by queueBuffer().
+     */
+    const void* getBufferData(const v4l2_buffer& vbuffer) const
+    {
+        return buffer_mmap_ptr[vbuffer.index].addr;
+    }
+
+    /** @brief Whether the frames are MJPEG, they are to be decoded by a JpegDecoder then
+     */
+    bool isCompressed() const { return pixel_format == V4L2_PIX_FMT_MJPEG; }
+
+    /** @brief The negotiated V4L2_PIX_FMT_*
+     */
+    uint getPixelFormat() const { return pixel_format; }
+
+    /** @brief The row pitch of raw frames as reported by the driver
+     */
+    uint getBytesPerLine() const { return bytes_per_line; }
+
+    /** @brief The negotiated frame width, the requested one before openDevice()
+     */
+    uint getWidth() const { return frame_width; }
+
+    /** @brief The negotiated frame height, the requested one before openDevice()
+     */
+    uint getHeight() const { return frame_height; }
+
+    /** @brief The frame rate the device reports for the negotiated mode
+     */
+    double getFPS() const { return double(interval_den) / interval_num; }
+
+    /** @brief The modes the device offers for the negotiated pixel format
+     */
+    const std::vector<Mode>& getModes() const { return modes; }
+
+    /** @brief The time openDevice() took, from open to stream on
+     */
+    long getStartupMs() const { return startup_ms; }
+
+    /** @brief The time from stream on to the first dequeued frame, -1 before it arrives
+     */
+    long getFirstFrameMs() const { return first_frame_ms; }
+
+    /** @brief The file descriptor of the device, -1 if it is not opened
+     */
+    int getFd() const { return this->cameraFd; }
+
+    /** @brief Bytes copied by user space for the latest frame, besides the decode itself
+     */
+    uint getCopiedBytes() const { return copied_bytes; }
+
+    /** @brief The number of frames dropped as corrupt by the decoder
+     */
+    uint getDroppedFrames() const { return decoder.getErrorCount(); }
+
+    /** @brief The number of older frames given back undecoded in latest-only mode
+     */
+    uint getSkippedFrames() const { return skipped_frames; }
 private:
     /** @brief Start/stop video capture
      */
@@ -107,11 +298,7 @@ private:
     void unMmapBuffers();
 
 
-    bool processImage(const void *p, uint size, unsigned char* data);
-
-    static bool waitAny(const std::vector<int>& camera_fds, std::vector<int> &ready_index, int64_t timeout_ms);
-
-    int getFd() { return this->cameraFd; }
+    bool processImage(const void *p, uint size, unsigned char* data, int pitch);
 
 
     void setSharpness(uint value)
@@ -123,12 +310,17 @@ private:
 
     void setFPS(uint value)
     {
-        this->fps = value;
+        this->interval_num = 1;
+        this->interval_den = value;
         initDevice(device_name);
     }
 
 private:
-    bool decodeJPEG(uchar* pcompressed_image, long unsigned int jpeg_size);
+    bool dequeue(v4l2_buffer& vbuffer);
+    bool dequeueLatest(v4l2_buffer& vbuffer);
+    bool queue(const v4l2_buffer& vbuffer);
+    bool convertRaw(const uchar* praw_image, uint size, uchar* data, int pitch);
+    bool decodeJPEG(const uchar* pcompressed_image, long unsigned int jpeg_size, uchar* data, int pitch);
     void resetDevice();
     bool tryIoctl(unsigned long ioctl_code, void *param, bool fail_if_busy = true, int attempts = 10) const;
 
@@ -143,13 +335,32 @@ private:
     bufferMmap  *buffer_mmap_ptr;
 
     char    device_name[256];
-    uchar  *decode_buffer;
-    uchar  *jpeg_buffer;
+    uint    copied_bytes;   // bytes copied for the latest frame, excluding decode output
+    JpegDecoder decoder;    // reused by every frame of the device
+    bool    latest_only;    // drain the queue and keep only the newest frame
+    std::atomic<uint> skipped_frames;   // frames re-queued undecoded in latest-only mode
+    uint    last_sequence;  // vbuffer.sequence of the latest frame
+    int64_t last_timestamp_us;  // vbuffer.timestamp of the latest frame
     uint    buffer_count;
-    uint    frame_width;
+    uint    requested_width;
+    uint    requested_height;
+    uint    frame_width;    // negotiated frame size
     uint    frame_height;
-    uint    fps;
+    uint    interval_num;   // negotiated frame interval, 1/60 s until negotiated
+    uint    interval_den;
+    ModePolicy mode_policy;
+    std::vector<Mode> modes;    // offered for pixel_format
     uint    sharpness;
+    StreamMode stream_mode;
+    uint    pixel_format;   // negotiated V4L2_PIX_FMT_*
+    uint    bytes_per_line; // row pitch of raw frames
+
+    std::string probe_key;  // card and bus info, the key of the cached probe
+    bool    probe_cached;   // the formats came from the probe cache
+    bool    mode_kept;      // no S_FMT/S_PARM was needed
+    long    startup_ms;
+    std::atomic<long> first_frame_ms;
+    std::chrono::steady_clock::time_point stream_on_time;
 
     std::mutex      mtx;
 };
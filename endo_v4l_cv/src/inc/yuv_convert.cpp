@@ -0,0 +1,176 @@
+#include "yuv_convert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define YUV_CONVERT_SSSE3 1
+#else
+#define YUV_CONVERT_SSSE3 0
+#endif
+
+namespace
+{
+    /* 6-bit fixed point BT.601 coefficients:
+       R = 1.164(Y-16) + 1.596(V-128)
+       G = 1.164(Y-16) - 0.392(U-128) - 0.813(V-128)
+       B = 1.164(Y-16) + 2.017(U-128) */
+    const int CY = 74, CRV = 102, CGU = 25, CGV = 52, CBU = 129;
+
+    inline byte clamp(int v)
+    {
+        return v < 0 ? 0 : (v > 255 ? 255 : byte(v));
+    }
+
+    inline void pixel(int y, int u, int v, byte *dst, bool bgr)
+    {
+        int yy = (y - 16) * CY + 32;
+        u -= 128;
+        v -= 128;
+        byte r = clamp((yy + CRV * v) >> 6);
+        byte g = clamp((yy - CGU * u - CGV * v) >> 6);
+        byte b = clamp((yy + CBU * u) >> 6);
+        dst[0] = bgr ? b : r;
+        dst[1] = g;
+        dst[2] = bgr ? r : b;
+    }
+
+    // y: 2 * count luma samples, uv: count U samples, each with V at uv + v_offset
+    void row_scalar(const byte *y, int y_step, const byte *uv, int uv_step, int v_offset, byte *dst, int count, bool bgr)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            pixel(y[0], uv[0], uv[v_offset], dst, bgr);
+            pixel(y[y_step], uv[0], uv[v_offset], dst + 3, bgr);
+            y += 2 * y_step;
+            uv += uv_step;
+            dst += 6;
+        }
+    }
+
+#if YUV_CONVERT_SSSE3
+    /* r, g, b of 8 pixels in 16-bit lanes, from 8 luma and [U0 V0 U1 V1 U2 V2 U3 V3] */
+    __attribute__((target("ssse3")))
+    inline void rgb8(__m128i y16, __m128i uv16, __m128i &r, __m128i &g, __m128i &b)
+    {
+        const __m128i c16 = _mm_set1_epi16(16), c128 = _mm_set1_epi16(128), c32 = _mm_set1_epi16(32);
+        __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv16, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv16, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+        u = _mm_sub_epi16(u, c128);
+        v = _mm_sub_epi16(v, c128);
+        __m128i yy = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(y16, c16), _mm_set1_epi16(CY)), c32);
+
+        // saturating adds, an overflow is far beyond 255 anyway
+        r = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(v, _mm_set1_epi16(CRV))), 6);
+        g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(u, _mm_set1_epi16(CGU))),
+                                          _mm_mullo_epi16(v, _mm_set1_epi16(CGV))), 6);
+        b = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(u, _mm_set1_epi16(CBU))), 6);
+    }
+
+    /* interleave 16 pixels of three planes into 48 packed bytes */
+    __attribute__((target("ssse3")))
+    inline void store48(__m128i c0, __m128i c1, __m128i c2, byte *dst)
+    {
+        const __m128i m00 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+        const __m128i m01 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+        const __m128i m02 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+        const __m128i m10 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+        const __m128i m11 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+        const __m128i m12 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+        const __m128i m20 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+        const __m128i m21 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+        const __m128i m22 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+        __m128i *out = reinterpret_cast<__m128i*>(dst);
+        _mm_storeu_si128(out, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(c1, m10)), _mm_shuffle_epi8(c2, m20)));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m01), _mm_shuffle_epi8(c1, m11)), _mm_shuffle_epi8(c2, m21)));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m02), _mm_shuffle_epi8(c1, m12)), _mm_shuffle_epi8(c2, m22)));
+    }
+
+    __attribute__((target("ssse3")))
+    inline void store16(__m128i y16a, __m128i uv16a, __m128i y16b, __m128i uv16b, byte *dst, bool bgr)
+    {
+        __m128i ra, ga, ba, rb, gb, bb;
+        rgb8(y16a, uv16a, ra, ga, ba);
+        rgb8(y16b, uv16b, rb, gb, bb);
+        __m128i r = _mm_packus_epi16(ra, rb);
+        __m128i g = _mm_packus_epi16(ga, gb);
+        __m128i b = _mm_packus_epi16(ba, bb);
+        if(bgr)
+            store48(b, g, r, dst);
+        else
+            store48(r, g, b, dst);
+    }
+
+    __attribute__((target("ssse3")))
+    void yuyv_row_ssse3(const byte *src, byte *dst, int width, bool bgr)
+    {
+        const __m128i low = _mm_set1_epi16(0x00FF);
+        int x = 0;
+        for(; x + 16 <= width; x += 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * x));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * x + 16));
+            store16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8),
+                    _mm_and_si128(b, low), _mm_srli_epi16(b, 8), dst + 3 * x, bgr);
+        }
+        row_scalar(src + 2 * x, 2, src + 2 * x + 1, 4, 2, dst + 3 * x, (width - x) / 2, bgr);
+    }
+
+    __attribute__((target("ssse3")))
+    void nv12_row_ssse3(const byte *y, const byte *uv, byte *dst, int width, bool bgr)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        int x = 0;
+        for(; x + 16 <= width; x += 16)
+        {
+            __m128i yv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+            __m128i uvv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x));
+            store16(_mm_unpacklo_epi8(yv, zero), _mm_unpacklo_epi8(uvv, zero),
+                    _mm_unpackhi_epi8(yv, zero), _mm_unpackhi_epi8(uvv, zero), dst + 3 * x, bgr);
+        }
+        row_scalar(y + x, 1, uv + x, 2, 1, dst + 3 * x, (width - x) / 2, bgr);
+    }
+
+    bool has_ssse3()
+    {
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+    }
+#endif
+}
+
+
+void yuyv2rgb(const byte *src, int src_pitch, byte *dst, int dst_pitch, int width, int height, bool bgr)
+{
+    for(int row = 0; row < height; row++)
+    {
+        const byte *s = src + row * src_pitch;
+        byte *d = dst + row * dst_pitch;
+#if YUV_CONVERT_SSSE3
+        if(has_ssse3())
+        {
+            yuyv_row_ssse3(s, d, width, bgr);
+            continue;
+        }
+#endif
+        // Y0 U Y1 V: luma every 2 bytes, the U/V pair every 4 bytes
+        row_scalar(s, 2, s + 1, 4, 2, d, width / 2, bgr);
+    }
+}
+
+void nv122rgb(const byte *y, int y_pitch, const byte *uv, int uv_pitch, byte *dst, int dst_pitch, int width, int height, bool bgr)
+{
+    for(int row = 0; row < height; row++)
+    {
+        const byte *ys = y + row * y_pitch;
+        const byte *uvs = uv + (row / 2) * uv_pitch;
+        byte *d = dst + row * dst_pitch;
+#if YUV_CONVERT_SSSE3
+        if(has_ssse3())
+        {
+            nv12_row_ssse3(ys, uvs, d, width, bgr);
+            continue;
+        }
+#endif
+        row_scalar(ys, 1, uvs, 2, 1, d, width / 2, bgr);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+using byte = unsigned char;
+
+/* Convert the raw formats of UVC cameras to packed 24-bit RGB (or BGR), BT.601 limited
+   range. The rows are converted 16 pixels at a time with SSSE3 when the CPU has it, the
+   scalar path gives the same result. width must be even; pitches are bytes per row. */
+
+void yuyv2rgb(const byte *src, int src_pitch, byte *dst, int dst_pitch, int width, int height, bool bgr = false);
+
+void nv122rgb(const byte *y, int y_pitch, const byte *uv, int uv_pitch, byte *dst, int dst_pitch, int width, int height, bool bgr = false);
+
+#endif // YUV_CONVERT_H
@@ -0,0 +1,98 @@
+#include "stereo_pairer.h"
+#include <cstdlib>
+
+namespace {
+    // A frame older than this many unmatched frames of its own eye will not be paired.
+    const size_t MAX_PENDING = 2;
+}
+
+
+StereoPairer::StereoPairer(int64_t tolerance_us)
+    : _tolerance_us(tolerance_us)
+    , _last_sequence{0, 0}
+    , _has_sequence{false, false}
+    , _has_newest(false)
+    , _stats() {
+}
+
+
+void StereoPairer::push(bool is_right, const EyeFrame& frame) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    int self = is_right, other = !is_right;
+    auto& mine = _pending[self];
+    auto& others = _pending[other];
+
+    // Gaps in the sequence numbers are frames the driver dropped.
+    if(_has_sequence[self] && frame.sequence > _last_sequence[self] + 1) {
+        _stats.lost[self] += frame.sequence - _last_sequence[self] - 1;
+    }
+    _last_sequence[self] = frame.sequence;
+    _has_sequence[self] = true;
+
+    // The frames of the other eye too old for this frame are too old for any later one.
+    while(!others.empty() && others.front().timestamp_us < frame.timestamp_us - _tolerance_us) {
+        others.pop_front();
+        _stats.unmatched[other]++;
+    }
+
+    auto best = others.end();
+    int64_t best_skew = _tolerance_us + 1;
+    for(auto it = others.begin(); it != others.end(); ++it) {
+        int64_t skew = std::llabs(it->timestamp_us - frame.timestamp_us);
+        if(skew < best_skew) {
+            best = it;
+            best_skew = skew;
+        }
+    }
+
+    if(best == others.end()) {
+        mine.push_back(frame);
+        if(mine.size() > MAX_PENDING) {
+            mine.pop_front();
+            _stats.unmatched[self]++;
+        }
+        return;
+    }
+
+    StereoPair pair;
+    pair.eye[self] = frame;
+    pair.eye[other] = *best;
+
+    // Everything queued before the matched frames can never be paired any more.
+    _stats.unmatched[other] += best - others.begin();
+    others.erase(others.begin(), best + 1);
+    _stats.unmatched[self] += mine.size();
+    mine.clear();
+
+    publish(pair);
+}
+
+
+bool StereoPairer::getNewest(StereoPair& pair) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if(_has_newest) {
+        pair = _newest;
+    }
+    return _has_newest;
+}
+
+
+StereoPairer::Stats StereoPairer::getStats() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _stats;
+}
+
+
+void StereoPairer::publish(const StereoPair& pair) {
+    _newest = pair;
+    _has_newest = true;
+
+    int64_t skew = pair.eye[1].timestamp_us - pair.eye[0].timestamp_us;
+    int64_t abs_skew = std::llabs(skew);
+    _stats.pairs++;
+    _stats.last_skew_us = skew;
+    if(abs_skew > _stats.max_skew_us) {
+        _stats.max_skew_us = abs_skew;
+    }
+    _stats.mean_skew_us += (abs_skew - _stats.mean_skew_us) / _stats.pairs;
+}
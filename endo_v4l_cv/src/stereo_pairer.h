@@ -0,0 +1,87 @@
+#ifndef H_WLF_761272A9_0EBA_4252_969A_A7CD80CAE32D
+#define H_WLF_761272A9_0EBA_4252_969A_A7CD80CAE32D
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief A decoded frame of one eye, with the capture time reported by the driver.
+ */
+struct EyeFrame {
+    std::shared_ptr<cv::Mat> image;     ///< The decode target, shared until released.
+    cv::Mat  view;                      ///< The decoded region of image, maybe downscaled.
+    uint32_t sequence;                  ///< The V4L2 sequence number of the device.
+    int64_t  timestamp_us;              ///< The kernel timestamp in microseconds.
+};
+
+/**
+ * @brief The left and right frames captured at the same moment.
+ */
+struct StereoPair {
+    EyeFrame eye[2];                    ///< The left [0] and right [1] frames.
+};
+
+/**
+ * @brief Matches left and right frames by their kernel timestamps, and publishes only the
+ * pairs whose skew is within the tolerance.
+ */
+class StereoPairer {
+public:
+    /**
+     * @brief Pairing statistics.
+     */
+    struct Stats {
+        uint64_t pairs;                 ///< The number of published pairs.
+        uint64_t unmatched[2];          ///< Frames dropped without a partner, per eye.
+        uint64_t lost[2];               ///< Frames missing in the sequence numbers, per eye.
+        int64_t  last_skew_us;          ///< Right minus left timestamp of the newest pair.
+        int64_t  max_skew_us;           ///< The largest absolute skew so far.
+        double   mean_skew_us;          ///< The mean absolute skew so far.
+    };
+
+    /**
+     * @brief Construct a new Stereo Pairer object.
+     * 
+     * @param tolerance_us The largest timestamp difference of a valid pair.
+     */
+    explicit StereoPairer(int64_t tolerance_us);
+
+    /**
+     * @brief Push a decoded frame, thread-safe.
+     * 
+     * @param is_right Whether the frame is from the right eye.
+     * @param frame The decoded frame.
+     */
+    void push(bool is_right, const EyeFrame& frame);
+
+    /**
+     * @brief Get the newest published pair.
+     * 
+     * @param pair The newest pair.
+     * @return 
+     *   @retval true If any pair has been published.
+     *   @retval false For no pair yet.
+     */
+    bool getNewest(StereoPair& pair);
+
+    /**
+     * @brief Get the pairing statistics.
+     */
+    Stats getStats();
+
+private:
+    void publish(const StereoPair& pair);
+
+    const int64_t _tolerance_us;    ///< The largest skew of a valid pair.
+    std::mutex    _mtx;             ///< Guards all the members below.
+    std::deque<EyeFrame> _pending[2];   ///< Frames waiting for a partner, oldest first.
+    uint32_t      _last_sequence[2];    ///< The last sequence number of each eye.
+    bool          _has_sequence[2];     ///< Whether a frame of the eye has been seen.
+    StereoPair    _newest;          ///< The newest published pair.
+    bool          _has_newest;      ///< Whether any pair is published.
+    Stats         _stats;           ///< The pairing statistics.
+};
+
+#endif /* H_WLF_761272A9_0EBA_4252_969A_A7CD80CAE32D */
@@ -0,0 +1,117 @@
+#include "frame_clock.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+namespace {
+    double toMs(FrameClock::Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+
+FrameClock::FrameClock(double fps)
+    : _fps(0)
+    , _period(0)
+    , _is_started(false)
+    , _first_timestamp_us(0)
+    , _last_timestamp_us(0)
+    , _frames(0)
+    , _late(0)
+    , _intervals(0)
+    , _sum_ms(0)
+    , _sum_sq_ms(0)
+    , _max_deviation_ms(0)
+    , _sum_lateness_ms(0) {
+    setFPS(fps);
+}
+
+void FrameClock::setFPS(double fps) {
+    _fps = fps > 0 ? fps : 0;
+    _period = _fps > 0 ? std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / _fps)) : Clock::duration(0);
+    _is_started = false;
+}
+
+void FrameClock::reset() {
+    _is_started = false;
+}
+
+void FrameClock::wait() {
+    auto now = Clock::now();
+    if(!_is_started) {
+        _is_started = true;
+        _next = now;
+    }
+    _next = sleepUntil(_next, now) + _period;
+}
+
+void FrameClock::waitTimestamp(int64_t timestamp_us) {
+    auto now = Clock::now();
+    if(!_is_started || timestamp_us < _last_timestamp_us) {
+        _is_started = true;
+        _anchor = now;
+        _first_timestamp_us = timestamp_us;
+    }
+    _last_timestamp_us = timestamp_us;
+    auto offset = std::chrono::microseconds(timestamp_us - _first_timestamp_us);
+    auto deadline = sleepUntil(_anchor + offset, now);
+    _anchor = deadline - offset;
+}
+
+void FrameClock::mark() {
+    auto now = Clock::now();
+    record(now, now);
+}
+
+FrameClock::Clock::time_point FrameClock::sleepUntil(Clock::time_point deadline,
+                                                     Clock::time_point now) {
+    // Behind by more than a frame, the missed deadlines are skipped and not rushed through
+    auto tolerance = std::max<Clock::duration>(_period, std::chrono::milliseconds(20));
+    if(now - deadline > tolerance) {
+        deadline = now;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _late++;
+    }
+    std::this_thread::sleep_until(deadline);
+    record(Clock::now(), deadline);
+    return deadline;
+}
+
+void FrameClock::record(Clock::time_point tick, Clock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_frames > 0) {
+        double interval_ms = toMs(tick - _last_tick);
+        _intervals++;
+        _sum_ms += interval_ms;
+        _sum_sq_ms += interval_ms * interval_ms;
+        double expected_ms = _fps > 0 ? 1000.0 / _fps : _sum_ms / _intervals;
+        _max_deviation_ms = std::max(_max_deviation_ms, std::fabs(interval_ms - expected_ms));
+    }
+    _sum_lateness_ms += toMs(tick - deadline);
+    _last_tick = tick;
+    _frames++;
+}
+
+FrameClock::Stats FrameClock::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats;
+    stats.frames = _frames;
+    stats.late = _late;
+    stats.mean_interval_ms = _intervals ? _sum_ms / _intervals : 0;
+    double variance = _intervals ? _sum_sq_ms / _intervals
+                      - stats.mean_interval_ms * stats.mean_interval_ms : 0;
+    stats.jitter_ms = std::sqrt(std::max(variance, 0.0));
+    stats.max_deviation_ms = _max_deviation_ms;
+    stats.mean_lateness_ms = _frames ? _sum_lateness_ms / _frames : 0;
+    return stats;
+}
+
+void FrameClock::printStats(const char* name) const {
+    auto stats = getStats();
+    printf("%s: [%lu] frames at [%.3f]ms, jitter [%.3f]ms, max deviation [%.3f]ms, "
+           "woke [%.3f]ms late, [%lu] restarts.\n", name, stats.frames,
+           stats.mean_interval_ms, stats.jitter_ms, stats.max_deviation_ms,
+           stats.mean_lateness_ms, stats.late);
+}
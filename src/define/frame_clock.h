@@ -0,0 +1,102 @@
+#ifndef H_WLF_8C38A324_6A56_41EF_BC36_C2EFF13305ED
+#define H_WLF_8C38A324_6A56_41EF_BC36_C2EFF13305ED
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Paces a frame loop against absolute deadlines and measures how steady it runs.
+ *
+ * The deadlines are counted from the start of the schedule, not from the last wakeup,
+ * so an oversleep or a slow frame is made up by the next wait instead of adding up. A
+ * loop that falls behind by more than a frame starts a new schedule rather than rushing
+ * the frames it missed. A loop paced by something else, e.g. a blocking camera read, only
+ * marks its frames to get the same statistics.
+ */
+class FrameClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief The cadence of the ticks so far.
+     */
+    struct Stats {
+        uint64_t frames;            ///< The ticks.
+        uint64_t late;              ///< The times the schedule restarted after falling behind.
+        double   mean_interval_ms;  ///< The mean time between two ticks.
+        double   jitter_ms;         ///< The standard deviation of the intervals.
+        double   max_deviation_ms;  ///< The largest difference of an interval from the period.
+        double   mean_lateness_ms;  ///< How late the waits woke up, on average.
+    };
+
+    /**
+     * @param fps The rate of wait(), 0 if only waitTimestamp() or mark() are used.
+     */
+    explicit FrameClock(double fps = 0);
+
+    /**
+     * @brief Change the rate, the schedule restarts at the next wait.
+     */
+    void setFPS(double fps);
+
+    double getFPS() const { return _fps; }
+
+    /**
+     * @brief Start a new schedule at the next wait, e.g. on a rewind of the source.
+     */
+    void reset();
+
+    /**
+     * @brief Sleep until the next deadline at the rate set.
+     */
+    void wait();
+
+    /**
+     * @brief Sleep until the time of a source timestamp, counted from the first one.
+     *
+     * @param timestamp_us The timestamp of the frame, in microseconds. A timestamp going
+     * back, e.g. on a loop of the source, starts a new schedule.
+     */
+    void waitTimestamp(int64_t timestamp_us);
+
+    /**
+     * @brief Record a tick of a loop paced elsewhere.
+     */
+    void mark();
+
+    Stats getStats() const;
+
+    /**
+     * @brief Print the statistics as "<name>: ...".
+     */
+    void printStats(const char* name) const;
+
+private:
+    /**
+     * @brief Sleep until deadline, or start a new schedule if it is a frame behind.
+     * @return The deadline slept until.
+     */
+    Clock::time_point sleepUntil(Clock::time_point deadline, Clock::time_point now);
+
+    void record(Clock::time_point tick, Clock::time_point deadline);
+
+    double              _fps;
+    Clock::duration     _period;        ///< 1/fps.
+    bool                _is_started;    ///< A schedule is running.
+    Clock::time_point   _next;          ///< The next deadline of wait().
+    Clock::time_point   _anchor;        ///< The time of the first timestamp.
+    int64_t             _first_timestamp_us;
+    int64_t             _last_timestamp_us;
+
+    mutable std::mutex  _mutex;         ///< The statistics are read by other threads.
+    Clock::time_point   _last_tick;
+    uint64_t            _frames;
+    uint64_t            _late;
+    uint64_t            _intervals;     ///< The ticks with a tick before them.
+    double              _sum_ms;        ///< The sum of the intervals.
+    double              _sum_sq_ms;     ///< The sum of the squared intervals.
+    double              _max_deviation_ms;
+    double              _sum_lateness_ms;
+};
+
+#endif /* H_WLF_8C38A324_6A56_41EF_BC36_C2EFF13305ED */
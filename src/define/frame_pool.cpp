@@ -0,0 +1,191 @@
+#include "frame_pool.h"
+#include <sys/mman.h>
+#include <cstring>
+#include <new>
+
+namespace {
+    const size_t SMALL_PAGE_SIZE = 4 * 1024;
+    const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+}
+
+
+FramePool& FramePool::getInstance() {
+    static FramePool* pool = new FramePool();
+    return *pool;
+}
+
+void FramePool::install() {
+    cv::Mat::setDefaultAllocator(&getInstance());
+}
+
+FramePool::FramePool()
+    : _hits(0)
+    , _misses(0)
+    , _slabs(0)
+    , _bytes(0)
+    , _huge_slabs(0) {
+    _free_headers.reserve(64);
+}
+
+void FramePool::reserve(size_t bytes, size_t count) {
+    size_t slab_size = getSlabSize(bytes);
+    std::vector<void*> slabs;
+    for(size_t i = 0; i < count; i++) {
+        void* slab = mapSlab(slab_size);
+        if(slab == nullptr) {
+            break;
+        }
+        slabs.push_back(slab);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& free_slabs = _free_slabs[slab_size];
+    free_slabs.reserve(free_slabs.size() + slabs.size() + 8);
+    free_slabs.insert(free_slabs.end(), slabs.begin(), slabs.end());
+}
+
+FramePool::Stats FramePool::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats;
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.slabs = _slabs;
+    stats.bytes = _bytes;
+    stats.huge_slabs = _huge_slabs;
+    stats.free_slabs = 0;
+    for(const auto& free_slabs : _free_slabs) {
+        stats.free_slabs += free_slabs.second.size();
+    }
+    return stats;
+}
+
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                  AccessFlag flags, cv::UMatUsageFlags usage_flags) const {
+    // The layout is computed as cv::Mat's own allocator does it
+    size_t total = CV_ELEM_SIZE(type);
+    for(int i = dims - 1; i >= 0; i--) {
+        if(step) {
+            if(data0 && step[i] != CV_AUTOSTEP) {
+                total = step[i];
+            }
+            else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+    if(data0 == nullptr && total < MIN_POOLED_SIZE) {
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data0, step,
+                                                    flags, usage_flags);
+    }
+
+    uchar* data = static_cast<uchar*>(data0);
+    if(data == nullptr) {
+        data = static_cast<uchar*>(acquire(getSlabSize(total)));
+        if(data == nullptr) {
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data0, step,
+                                                        flags, usage_flags);
+        }
+    }
+
+    cv::UMatData* u = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_free_headers.empty()) {
+            u = _free_headers.back();
+            _free_headers.pop_back();
+        }
+    }
+    u = u ? new(u) cv::UMatData(this) : new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if(data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData* u, AccessFlag, cv::UMatUsageFlags) const {
+    return u != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData* u) const {
+    if(u == nullptr) {
+        return;
+    }
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if(!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        release(u->origdata, getSlabSize(u->size));
+        u->origdata = 0;
+    }
+    // The header is kept for the next buffer as well
+    u->~UMatData();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free_headers.push_back(u);
+}
+
+size_t FramePool::getSlabSize(size_t bytes) {
+    size_t page = bytes < HUGE_PAGE_SIZE ? SMALL_PAGE_SIZE : HUGE_PAGE_SIZE;
+    return (bytes + page - 1) / page * page;
+}
+
+void* FramePool::acquire(size_t slab_size) const {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto iter = _free_slabs.find(slab_size);
+        if(iter != _free_slabs.end() && !iter->second.empty()) {
+            void* slab = iter->second.back();
+            iter->second.pop_back();
+            _hits++;
+            return slab;
+        }
+    }
+    _misses++;
+    return mapSlab(slab_size);
+}
+
+void FramePool::release(void* slab, size_t slab_size) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free_slabs[slab_size].push_back(slab);
+}
+
+void* FramePool::mapSlab(size_t slab_size) const {
+    bool is_huge = false;
+    void* slab = MAP_FAILED;
+    if(slab_size >= HUGE_PAGE_SIZE) {
+        is_huge = true;
+        slab = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if(slab == MAP_FAILED) {
+            // No huge pages reserved, ask for transparent ones and fault the pages in now
+            is_huge = false;
+            slab = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(slab != MAP_FAILED) {
+                madvise(slab, slab_size, MADV_HUGEPAGE);
+                memset(slab, 0, slab_size);
+            }
+        }
+    }
+    else {
+        // Below one huge page, 4 KB pages faulted in by the kernel
+        slab = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    }
+    if(slab == MAP_FAILED) {
+        printf("FramePool: cannot map a slab of [%zu] bytes.\n", slab_size);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slabs++;
+    _bytes += slab_size;
+    _huge_slabs += is_huge;
+    // Room for the slab in the free list, so releasing it does not allocate
+    auto& free_slabs = _free_slabs[slab_size];
+    if(free_slabs.capacity() < _slabs) {
+        free_slabs.reserve(_slabs + 8);
+    }
+    return slab;
+}
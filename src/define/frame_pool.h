@@ -0,0 +1,94 @@
+#ifndef H_WLF_D7802C7E_8D85_4100_846A_52206E11A50C
+#define H_WLF_D7802C7E_8D85_4100_846A_52206E11A50C
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A pool of frame buffers that plugs into cv::Mat as its allocator.
+ *
+ * Buffers of at least MIN_POOLED_SIZE are taken from slabs that are kept after release and
+ * handed out again for the same size, so a pipeline that keeps its frame sizes allocates
+ * nothing once warmed up. Slabs of 2 MB and more are mapped with huge pages when the
+ * system has them, otherwise with transparent huge pages, smaller ones with 4 KB pages.
+ * All of them are faulted in when mapped so that no page fault lands on a frame. Smaller
+ * buffers go to the OpenCV allocator.
+ */
+class FramePool : public cv::MatAllocator {
+public:
+#if CV_VERSION_MAJOR >= 4
+    using AccessFlag = cv::AccessFlag;
+#else
+    using AccessFlag = int;
+#endif
+
+    /**
+     * @brief The counters of the pool.
+     */
+    struct Stats {
+        uint64_t hits;          ///< Buffers served from a released slab.
+        uint64_t misses;        ///< Buffers that needed a new slab.
+        size_t   slabs;         ///< All the slabs mapped.
+        size_t   free_slabs;    ///< The slabs waiting to be reused.
+        size_t   bytes;         ///< The bytes of all the slabs.
+        size_t   huge_slabs;    ///< The slabs backed by explicit huge pages.
+    };
+
+    static const size_t MIN_POOLED_SIZE = 256 * 1024;   ///< Smaller buffers are not pooled.
+
+    /**
+     * @brief The pool of the process, it is never destroyed as Mats may outlive main().
+     */
+    static FramePool& getInstance();
+
+    /**
+     * @brief Make the pool the allocator of every cv::Mat created afterwards.
+     */
+    static void install();
+
+    /**
+     * @brief Map count slabs for buffers of bytes, e.g. from the negotiated frame size, so
+     * that even the first frames are hits.
+     */
+    void reserve(size_t bytes, size_t count);
+
+    /**
+     * @brief Get the counters.
+     */
+    Stats getStats() const;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData* data, AccessFlag access_flags,
+                  cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+private:
+    FramePool();
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * @brief The size of the slab of a buffer, whole 4 KB pages below 2 MB and whole 2 MB
+     * huge pages from there on, so a small buffer does not waste most of a huge page.
+     */
+    static size_t getSlabSize(size_t bytes);
+
+    void* acquire(size_t slab_size) const;
+    void  release(void* slab, size_t slab_size) const;
+    void* mapSlab(size_t slab_size) const;
+
+    mutable std::mutex _mutex;
+    mutable std::map<size_t, std::vector<void*>> _free_slabs;   ///< Released slabs by size.
+    mutable std::vector<cv::UMatData*> _free_headers;           ///< Released Mat headers.
+    mutable std::atomic<uint64_t> _hits;
+    mutable std::atomic<uint64_t> _misses;
+    mutable size_t _slabs;
+    mutable size_t _bytes;
+    mutable size_t _huge_slabs;
+};
+
+#endif /* H_WLF_D7802C7E_8D85_4100_846A_52206E11A50C */
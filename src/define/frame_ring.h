@@ -0,0 +1,209 @@
+#ifndef H_WLF_100BE054_26C9_4644_BD9E_41C3E3C15501
+#define H_WLF_100BE054_26C9_4644_BD9E_41C3E3C15501
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A lock-free ring of N pooled frames, written by one thread and read by any number.
+ *
+ * The writer fills a free slot in place and publishes it as the newest frame. A reader
+ * takes a Handle on the newest frame, which keeps the slot from being written until the
+ * Handle is gone, so frames are shared without being copied. A slot is free once it is
+ * neither the newest nor held, the writer drops a frame if every other slot is held, so
+ * N should be at least the number of readers plus two.
+ */
+template <typename T, size_t N = 4>
+class FrameRing
+{
+    static_assert(N >= 2, "FrameRing needs a slot to publish and one to write");
+
+    static const uint32_t WRITING = 0x80000000u;  ///< The ref bit of the slot being written.
+
+    struct Slot {
+        T                     value;
+        std::atomic<uint32_t> refs;     ///< Held handles, plus WRITING while written.
+        std::atomic<uint64_t> sequence; ///< The number of the frame, set before publishing.
+    };
+
+public:
+    /**
+     * @brief A reference-counted read of a published frame.
+     */
+    class Handle {
+    public:
+        Handle() : _slot(nullptr) {}
+        Handle(Handle&& other) : _slot(other._slot) {
+            other._slot = nullptr;
+        }
+        Handle& operator=(Handle&& other) {
+            if(this != &other) {
+                reset();
+                _slot = other._slot;
+                other._slot = nullptr;
+            }
+            return *this;
+        }
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle() { reset(); }
+
+        /**
+         * @brief Give the frame back, the writer may reuse its slot afterwards.
+         */
+        void reset() {
+            if(_slot) {
+                _slot->refs.fetch_sub(1);
+                _slot = nullptr;
+            }
+        }
+
+        explicit operator bool() const { return _slot != nullptr; }
+        const T& operator*() const { return _slot->value; }
+        const T* operator->() const { return &_slot->value; }
+
+        /**
+         * @brief The number of the frame, increasing by one per published frame.
+         */
+        uint64_t getSequence() const { return _slot ? _slot->sequence.load() : 0; }
+
+    private:
+        friend class FrameRing;
+        explicit Handle(Slot* slot) : _slot(slot) {}
+
+        Slot* _slot;    ///< The held slot, nullptr if none.
+    };
+
+    FrameRing();
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * @brief Claim a free slot to write the next frame into, in place.
+     *
+     * The slot keeps its previous content, so buffers like cv::Mat are reused.
+     * @return The slot, or nullptr if every other slot is held and the frame is to be dropped.
+     */
+    T* beginWrite();
+
+    /**
+     * @brief Publish the slot from beginWrite() as the newest frame.
+     */
+    void commitWrite();
+
+    /**
+     * @brief Give the slot from beginWrite() back unpublished.
+     */
+    void cancelWrite();
+
+    /**
+     * @brief Hold the newest frame, an empty Handle before the first frame.
+     */
+    Handle readNewest();
+
+    /**
+     * @brief The number of the newest frame, 0 before the first frame.
+     */
+    uint64_t getNewestSequence() const;
+
+    /**
+     * @brief The frames dropped as no slot was free.
+     */
+    uint64_t getDropCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+    static constexpr size_t size() { return N; }
+
+private:
+    Slot                 _slots[N];
+    std::atomic<int>     _newest;   ///< The published slot, -1 before the first frame.
+    int                  _writing;  ///< The slot claimed by the writer, -1 if none.
+    uint64_t             _sequence; ///< The number of the last published frame.
+    std::atomic<uint64_t> _dropped;
+};
+
+/* include implementation in header since it is a template */
+
+template <typename T, size_t N>
+FrameRing<T, N>::FrameRing()
+    : _newest(-1)
+    , _writing(-1)
+    , _sequence(0)
+    , _dropped(0) {
+    for(auto& slot : _slots) {
+        slot.refs.store(0);
+        slot.sequence.store(0);
+    }
+}
+
+template <typename T, size_t N>
+T* FrameRing<T, N>::beginWrite() {
+    if(_writing >= 0) {
+        return &_slots[_writing].value;
+    }
+    // Only the writer changes _newest, so the newest slot cannot move away here
+    int newest = _newest.load();
+    size_t start = newest < 0 ? 0 : newest;
+    for(size_t i = 1; i <= N; i++) {
+        int idx = (start + i) % N;
+        if(idx == newest) {
+            continue;
+        }
+        uint32_t expected = 0;
+        if(_slots[idx].refs.compare_exchange_strong(expected, WRITING)) {
+            _writing = idx;
+            return &_slots[idx].value;
+        }
+    }
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+template <typename T, size_t N>
+void FrameRing<T, N>::commitWrite() {
+    if(_writing < 0) {
+        return;
+    }
+    Slot& slot = _slots[_writing];
+    slot.sequence.store(++_sequence);
+    // Readers that raced on the slot while it was written left their count, so only the
+    // bit is taken away
+    slot.refs.fetch_sub(WRITING);
+    _newest.store(_writing);
+    _writing = -1;
+}
+
+template <typename T, size_t N>
+void FrameRing<T, N>::cancelWrite() {
+    if(_writing < 0) {
+        return;
+    }
+    _slots[_writing].refs.fetch_sub(WRITING);
+    _writing = -1;
+}
+
+template <typename T, size_t N>
+typename FrameRing<T, N>::Handle FrameRing<T, N>::readNewest() {
+    while(true) {
+        int newest = _newest.load();
+        if(newest < 0) {
+            return Handle();
+        }
+        // The count is taken first, then checked that the slot is still the newest: the
+        // writer never claims the newest slot, and a slot claimed before the count was
+        // taken is not the newest any more.
+        Slot& slot = _slots[newest];
+        slot.refs.fetch_add(1);
+        if(_newest.load() == newest) {
+            return Handle(&slot);
+        }
+        slot.refs.fetch_sub(1);
+    }
+}
+
+template <typename T, size_t N>
+uint64_t FrameRing<T, N>::getNewestSequence() const {
+    int newest = _newest.load();
+    return newest < 0 ? 0 : _slots[newest].sequence.load();
+}
+
+#endif /* H_WLF_100BE054_26C9_4644_BD9E_41C3E3C15501 */
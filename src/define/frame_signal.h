@@ -0,0 +1,99 @@
+#ifndef H_WLF_D44D167E_5C3E_4235_B200_1337A770296B
+#define H_WLF_D44D167E_5C3E_4235_B200_1337A770296B
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief A "new frame available" signal on a futex, shared by any number of sources and
+ * waiters.
+ *
+ * notify() only moves an epoch forward, so the posts that arrive while a waiter is busy
+ * collapse into one wakeup instead of being counted as with a semaphore. A waiter tells
+ * what it waits for by a predicate, e.g. that both eyes have a frame newer than the shown
+ * one, which is how several sources are waited on at once.
+ */
+class FrameSignal {
+public:
+    FrameSignal() : _epoch(0), _waiters(0) {}
+    FrameSignal(const FrameSignal&) = delete;
+    FrameSignal& operator=(const FrameSignal&) = delete;
+
+    /**
+     * @brief Signal a new frame, waking all the waiters.
+     */
+    void notify() {
+        _epoch.fetch_add(1);
+        // No syscall while nobody sleeps, the common case of a busy display
+        if(_waiters.load() > 0) {
+            futex(FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+        }
+    }
+
+    /**
+     * @brief Get the number of notifications so far.
+     */
+    uint32_t getEpoch() const { return _epoch.load(); }
+
+    /**
+     * @brief Wait until a notification after the one read as seen.
+     *
+     * @param seen The epoch read before the wait condition was checked.
+     * @param timeout_ms Give up after this time, negative to wait forever.
+     * @return false on timeout.
+     */
+    bool wait(uint32_t seen, int timeout_ms = -1) {
+        timespec timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        _waiters.fetch_add(1);
+        // Returns at once if the epoch moved since it was seen
+        futex(FUTEX_WAIT_PRIVATE, seen, timeout_ms < 0 ? nullptr : &timeout);
+        _waiters.fetch_sub(1);
+        return _epoch.load() != seen;
+    }
+
+    /**
+     * @brief Wait until the predicate holds, it is checked again after each notification.
+     *
+     * @param timeout_ms Give up after this time, negative to wait forever.
+     * @return false on timeout.
+     */
+    template <typename Pred>
+    bool waitUntil(Pred pred, int timeout_ms = -1) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while(true) {
+            uint32_t seen = getEpoch();
+            if(pred()) {
+                return true;
+            }
+            int remaining_ms = -1;
+            if(timeout_ms >= 0) {
+                remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                if(remaining_ms <= 0) {
+                    return false;
+                }
+            }
+            wait(seen, remaining_ms);
+        }
+    }
+
+private:
+    long futex(int op, uint32_t value, const timespec* timeout) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_epoch), op, value, timeout,
+                       nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain word");
+
+    std::atomic<uint32_t> _epoch;   ///< The futex word, moved by every notification.
+    std::atomic<int>      _waiters; ///< Threads sleeping in wait().
+};
+
+#endif /* H_WLF_D44D167E_5C3E_4235_B200_1337A770296B */
@@ -0,0 +1,113 @@
+#include "hcompress.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define HCOMPRESS_SSSE3 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HCOMPRESS_NEON 1
+#endif
+
+namespace {
+    /**
+     * @brief The scalar packing of the pixels from x on, (a + b + 1) / 2 like the SIMD ones.
+     */
+    void packRowScalar(const uchar* src, uchar* dst, int x, int width) {
+        for(; x < width; x++) {
+            const uchar* s = src + 6*x;
+            uchar* d = dst + 3*x;
+            d[0] = (uchar)((s[0] + s[3] + 1) >> 1);
+            d[1] = (uchar)((s[1] + s[4] + 1) >> 1);
+            d[2] = (uchar)((s[2] + s[5] + 1) >> 1);
+        }
+    }
+
+#if HCOMPRESS_SSSE3
+    /**
+     * @brief Pack 4 pixels a step, from the 8 pixels read in two loads 12 bytes apart. The
+     * first and the second pixel of each pair are gathered by a shuffle and averaged.
+     */
+    __attribute__((target("ssse3")))
+    void packRowSsse3(const uchar* src, uchar* dst, int width) {
+        const __m128i first_lo  = _mm_setr_epi8(0, 1, 2, 6, 7, 8, -1, -1,
+                                                -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i second_lo = _mm_setr_epi8(3, 4, 5, 9, 10, 11, -1, -1,
+                                                -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i first_hi  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 0, 1,
+                                                2, 6, 7, 8, -1, -1, -1, -1);
+        const __m128i second_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 3, 4,
+                                                5, 9, 10, 11, -1, -1, -1, -1);
+        int x = 0;
+        // The second load reads 4 bytes past the step, so the last pixels are left over
+        for(; x + 5 <= width; x += 4) {
+            const uchar* s = src + 6*x;
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12));
+            __m128i first = _mm_or_si128(_mm_shuffle_epi8(lo, first_lo),
+                                         _mm_shuffle_epi8(hi, first_hi));
+            __m128i second = _mm_or_si128(_mm_shuffle_epi8(lo, second_lo),
+                                          _mm_shuffle_epi8(hi, second_hi));
+            __m128i packed = _mm_avg_epu8(first, second);
+
+            uchar* d = dst + 3*x;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(d), packed);
+            int tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+            memcpy(d + 8, &tail, 4);
+        }
+        packRowScalar(src, dst, x, width);
+    }
+
+    bool hasSsse3() {
+        static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+        return has_ssse3;
+    }
+#endif
+
+#if HCOMPRESS_NEON
+    /**
+     * @brief Pack 8 pixels a step, the channels are split by the load and the neighbours
+     * added pairwise.
+     */
+    void packRowNeon(const uchar* src, uchar* dst, int width) {
+        int x = 0;
+        for(; x + 8 <= width; x += 8) {
+            uint8x16x3_t pixels = vld3q_u8(src + 6*x);
+            uint8x8x3_t packed;
+            for(int c = 0; c < 3; c++) {
+                packed.val[c] = vrshrn_n_u16(vpaddlq_u8(pixels.val[c]), 1);
+            }
+            vst3_u8(dst + 3*x, packed);
+        }
+        packRowScalar(src, dst, x, width);
+    }
+#endif
+
+    void packRow(const uchar* src, uchar* dst, int width) {
+#if HCOMPRESS_SSSE3
+        if(hasSsse3()) {
+            packRowSsse3(src, dst, width);
+            return;
+        }
+#elif HCOMPRESS_NEON
+        packRowNeon(src, dst, width);
+        return;
+#endif
+        packRowScalar(src, dst, 0, width);
+    }
+}
+
+
+void resizeHalfWidth(const cv::Mat& src, cv::Mat& dst, int interpolation) {
+    bool is_packed = src.type() == CV_8UC3 && dst.type() == CV_8UC3
+                     && src.cols == 2 * dst.cols && src.rows == dst.rows;
+    if(!is_packed) {
+        cv::resize(src, dst, dst.size(), 0, 0, interpolation);
+        return;
+    }
+    // The rows are split like cv::resize does, it runs on all the cores as well
+    cv::parallel_for_(cv::Range(0, dst.rows), [&](const cv::Range& range) {
+        for(int y = range.start; y < range.end; y++) {
+            packRow(src.ptr(y), dst.ptr(y), dst.cols);
+        }
+    });
+}
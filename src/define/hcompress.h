@@ -0,0 +1,18 @@
+#ifndef H_WLF_6440C0B5_3794_490E_9BAB_F2A2F3C0C262
+#define H_WLF_6440C0B5_3794_490E_9BAB_F2A2F3C0C262
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief Resize an eye into its half of an h-compressed side-by-side frame, the format of
+ * the passive 3D monitors, where each eye is squeezed to half the width.
+ *
+ * A full width eye on a monitor of its height, e.g. 1920x1080 into 960x1080, is packed by
+ * averaging every two neighbouring pixels with SSSE3 or NEON. Any other ratio goes through
+ * cv::resize with the interpolation given.
+ * @param src The eye, 8-bit 3-channel.
+ * @param dst The region of the eye in the frame, of the size to resize to.
+ * @param interpolation The interpolation of cv::resize for other ratios.
+ */
+void resizeHalfWidth(const cv::Mat& src, cv::Mat& dst, int interpolation);
+
+#endif /* H_WLF_6440C0B5_3794_490E_9BAB_F2A2F3C0C262 */
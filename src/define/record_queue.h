@@ -0,0 +1,200 @@
+#ifndef H_WLF_6E0B1C57_93A4_4F0E_A2D8_5B7C19E4D3F6
+#define H_WLF_6E0B1C57_93A4_4F0E_A2D8_5B7C19E4D3F6
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief What a recording does when the writer falls behind and its queue is full.
+ */
+enum RecordPolicy : uint8_t {
+    RECORD_BLOCK,           ///< The capture waits for the writer, nothing is lost.
+    RECORD_DROP_OLDEST,     ///< The oldest queued frame is dropped for the new one.
+    RECORD_DROP_NEWEST,     ///< The new frame is dropped.
+    RECORD_POLICY_NUM
+};
+
+/**
+ * @brief Parse the record policy from its name, "block", "oldest" or "newest".
+ *
+ * @param name The given name.
+ * @param policy The parsed policy.
+ * @return
+ *   @retval true For parsed successfully.
+ *   @retval false For an unknown name.
+ */
+inline bool parseRecordPolicy(const std::string& name, RecordPolicy& policy) {
+    static const char* names[RECORD_POLICY_NUM] = { "block", "oldest", "newest" };
+    for(int i = 0; i < RECORD_POLICY_NUM; i++) {
+        if(name == names[i]) {
+            policy = static_cast<RecordPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief A bounded FIFO between one capture thread and the writer, every frame goes in
+ * order unless the policy drops it, and each drop is counted.
+ *
+ * The queue is closed while not recording, a push is refused then without being counted,
+ * so the counters cover one recording session from open() to close().
+ */
+template <typename T>
+class RecordQueue {
+public:
+    /**
+     * @brief The counters of the session.
+     */
+    struct Stats {
+        uint64_t pushed;    ///< The frames offered while open.
+        uint64_t enqueued;  ///< The frames queued.
+        uint64_t dropped;   ///< The frames dropped by the policy, queued or not.
+        size_t   max_size;  ///< The most frames queued at once.
+    };
+
+    explicit RecordQueue(size_t capacity = 16, RecordPolicy policy = RECORD_BLOCK);
+    RecordQueue(const RecordQueue&) = delete;
+    RecordQueue& operator=(const RecordQueue&) = delete;
+
+    /**
+     * @brief Set the policy, only while closed.
+     */
+    void setPolicy(RecordPolicy policy) { _policy = policy; }
+
+    /**
+     * @brief Start a session, the queue is emptied and the counters reset.
+     */
+    void open();
+
+    /**
+     * @brief End the session, the pushes are refused and a blocked one returns. The queued
+     * frames can still be popped.
+     */
+    void close();
+
+    /**
+     * @brief Queue a frame, waiting for room as long as the policy is RECORD_BLOCK.
+     *
+     * @return false if the frame is dropped or the queue is closed.
+     */
+    bool push(T&& item);
+
+    /**
+     * @brief Take the oldest frame.
+     *
+     * @param timeout_ms Give up after this time if the queue is empty.
+     * @return false on timeout.
+     */
+    bool pop(T& item, int timeout_ms);
+
+    Stats getStats() const;
+
+private:
+    std::vector<T>  _items;     ///< The ring of the queued frames.
+    size_t          _head;      ///< The oldest frame.
+    size_t          _size;
+    bool            _is_open;
+    RecordPolicy    _policy;
+    Stats           _stats;
+
+    mutable std::mutex      _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+};
+
+
+template <typename T>
+RecordQueue<T>::RecordQueue(size_t capacity, RecordPolicy policy)
+    : _items(capacity)
+    , _head(0)
+    , _size(0)
+    , _is_open(false)
+    , _policy(policy)
+    , _stats() {
+}
+
+template <typename T>
+void RecordQueue<T>::open() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(; _size > 0; _size--) {
+        _items[_head] = T();
+        _head = (_head + 1) % _items.size();
+    }
+    _stats = Stats();
+    _is_open = true;
+}
+
+template <typename T>
+void RecordQueue<T>::close() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _is_open = false;
+    }
+    _not_full.notify_all();
+}
+
+template <typename T>
+bool RecordQueue<T>::push(T&& item) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(!_is_open) {
+        return false;
+    }
+    _stats.pushed++;
+    if(_size == _items.size()) {
+        if(_policy == RECORD_DROP_NEWEST) {
+            _stats.dropped++;
+            return false;
+        }
+        else if(_policy == RECORD_DROP_OLDEST) {
+            _head = (_head + 1) % _items.size();
+            _size--;
+            _stats.dropped++;
+        }
+        else {
+            _not_full.wait(lock, [this]() { return _size < _items.size() || !_is_open; });
+            if(!_is_open) {
+                _stats.dropped++;
+                return false;
+            }
+        }
+    }
+    // The slot of a dropped frame is reused, its buffer is released by the assignment
+    _items[(_head + _size) % _items.size()] = std::move(item);
+    _size++;
+    _stats.enqueued++;
+    _stats.max_size = std::max(_stats.max_size, _size);
+    lock.unlock();
+    _not_empty.notify_one();
+    return true;
+}
+
+template <typename T>
+bool RecordQueue<T>::pop(T& item, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(!_not_empty.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                            [this]() { return _size > 0; })) {
+        return false;
+    }
+    item = std::move(_items[_head]);
+    _items[_head] = T();
+    _head = (_head + 1) % _items.size();
+    _size--;
+    lock.unlock();
+    _not_full.notify_one();
+    return true;
+}
+
+template <typename T>
+typename RecordQueue<T>::Stats RecordQueue<T>::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+#endif /* H_WLF_6E0B1C57_93A4_4F0E_A2D8_5B7C19E4D3F6 */
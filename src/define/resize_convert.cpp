@@ -0,0 +1,251 @@
+#include "resize_convert.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESIZE_CONVERT_X86 1
+#endif
+
+namespace {
+    // The weights of both passes have 7 bits, so a filtered row fits in 16 bits and the
+    // vertical blend is one multiply-add of 16-bit pairs
+    const int COEF_BITS = 7;
+    const int COEF_ONE = 1 << COEF_BITS;
+    const int BLEND_SHIFT = 2 * COEF_BITS;
+    const int BLEND_ROUND = 1 << (BLEND_SHIFT - 1);
+
+    /**
+     * @brief The two source taps and the weight of the second one, for each destination
+     * column or row, with the pixel centers aligned as cv::INTER_LINEAR does.
+     */
+    void computeTaps(int src_len, int dst_len, std::vector<int>& first,
+                     std::vector<int>& second, std::vector<short>& weights) {
+        first.resize(dst_len);
+        second.resize(dst_len);
+        weights.resize(dst_len);
+        double scale = 1. * src_len / dst_len;
+        for(int i = 0; i < dst_len; i++) {
+            double pos = (i + 0.5) * scale - 0.5;
+            int index = static_cast<int>(std::floor(pos));
+            int weight = static_cast<int>(std::lround((pos - index) * COEF_ONE));
+            if(weight == COEF_ONE) {
+                index++;
+                weight = 0;
+            }
+            if(index < 0) {
+                index = 0;
+                weight = 0;
+            }
+            if(index >= src_len - 1) {
+                index = src_len - 1;
+                weight = 0;
+            }
+            first[i] = index;
+            second[i] = std::min(index + 1, src_len - 1);
+            weights[i] = static_cast<short>(weight);
+        }
+    }
+
+    /**
+     * @brief The horizontal pass of one source row, the channels are swapped here.
+     */
+    void filterRow(const uchar* src, short* row, const int* first, const int* second,
+                   const short* weights, int width, bool is_swap_rb) {
+        int c0 = is_swap_rb ? 2 : 0;
+        int c2 = 2 - c0;
+        for(int x = 0; x < width; x++) {
+            const uchar* a = src + first[x];
+            const uchar* b = src + second[x];
+            int w1 = weights[x];
+            int w0 = COEF_ONE - w1;
+            short* d = row + 3*x;
+            d[0] = static_cast<short>(a[c0] * w0 + b[c0] * w1);
+            d[1] = static_cast<short>(a[1] * w0 + b[1] * w1);
+            d[2] = static_cast<short>(a[c2] * w0 + b[c2] * w1);
+        }
+    }
+
+    /**
+     * @brief The vertical pass from i on, the two filtered rows are blended into dst.
+     */
+    void blendRowsScalar(const short* row0, const short* row1, int weight, uchar* dst,
+                         int i, int count) {
+        int w0 = COEF_ONE - weight;
+        for(; i < count; i++) {
+            int value = (row0[i] * w0 + row1[i] * weight + BLEND_ROUND) >> BLEND_SHIFT;
+            dst[i] = static_cast<uchar>(std::min(std::max(value, 0), 255));
+        }
+    }
+
+#if RESIZE_CONVERT_X86
+    /**
+     * @brief Blend 8 values of the two rows, interleaved in pairs for _mm_madd_epi16.
+     */
+    __attribute__((target("sse4.1")))
+    __m128i blend8(const short* row0, const short* row1, __m128i weights, __m128i round) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), BLEND_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), BLEND_SHIFT);
+        return _mm_packus_epi32(lo, hi);
+    }
+
+    /**
+     * @brief 16 values a step.
+     */
+    __attribute__((target("sse4.1")))
+    void blendRowsSse41(const short* row0, const short* row1, int weight, uchar* dst,
+                        int count) {
+        const __m128i weights = _mm_set1_epi32((weight << 16) | (COEF_ONE - weight));
+        const __m128i round = _mm_set1_epi32(BLEND_ROUND);
+        int i = 0;
+        for(; i + 16 <= count; i += 16) {
+            __m128i first = blend8(row0 + i, row1 + i, weights, round);
+            __m128i second = blend8(row0 + i + 8, row1 + i + 8, weights, round);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                             _mm_packus_epi16(first, second));
+        }
+        blendRowsScalar(row0, row1, weight, dst, i, count);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i blend16(const short* row0, const short* row1, __m256i weights, __m256i round) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1));
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights);
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), BLEND_SHIFT);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), BLEND_SHIFT);
+        return _mm256_packus_epi32(lo, hi);
+    }
+
+    /**
+     * @brief 32 values a step. The packs work within each 128-bit lane, so the bytes are
+     * put back in order by one permute at the end.
+     */
+    __attribute__((target("avx2")))
+    void blendRowsAvx2(const short* row0, const short* row1, int weight, uchar* dst,
+                       int count) {
+        const __m256i weights = _mm256_set1_epi32((weight << 16) | (COEF_ONE - weight));
+        const __m256i round = _mm256_set1_epi32(BLEND_ROUND);
+        int i = 0;
+        for(; i + 32 <= count; i += 32) {
+            __m256i first = blend16(row0 + i, row1 + i, weights, round);
+            __m256i second = blend16(row0 + i + 16, row1 + i + 16, weights, round);
+            __m256i packed = _mm256_packus_epi16(first, second);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                                _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+        blendRowsScalar(row0, row1, weight, dst, i, count);
+    }
+#endif
+
+    ResizeKernel resolveKernel(ResizeKernel kernel) {
+        if(kernel == RESIZE_KERNEL_AUTO) {
+            static const ResizeKernel best = isResizeKernelSupported(RESIZE_KERNEL_AVX2)
+                ? RESIZE_KERNEL_AVX2 : isResizeKernelSupported(RESIZE_KERNEL_SSE41)
+                ? RESIZE_KERNEL_SSE41 : RESIZE_KERNEL_SCALAR;
+            return best;
+        }
+        return isResizeKernelSupported(kernel) ? kernel : RESIZE_KERNEL_SCALAR;
+    }
+
+    void blendRows(ResizeKernel kernel, const short* row0, const short* row1, int weight,
+                   uchar* dst, int count) {
+#if RESIZE_CONVERT_X86
+        if(kernel == RESIZE_KERNEL_AVX2) {
+            blendRowsAvx2(row0, row1, weight, dst, count);
+            return;
+        }
+        if(kernel == RESIZE_KERNEL_SSE41) {
+            blendRowsSse41(row0, row1, weight, dst, count);
+            return;
+        }
+#endif
+        blendRowsScalar(row0, row1, weight, dst, 0, count);
+    }
+}
+
+
+bool isResizeKernelSupported(ResizeKernel kernel) {
+    switch (kernel)
+    {
+    case RESIZE_KERNEL_AUTO:
+    case RESIZE_KERNEL_SCALAR:
+        return true;
+#if RESIZE_CONVERT_X86
+    case RESIZE_KERNEL_SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case RESIZE_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* getResizeKernelName(ResizeKernel kernel) {
+    static const char* names[RESIZE_KERNEL_NUM] = { "auto", "scalar", "sse4.1", "avx2" };
+    return kernel < RESIZE_KERNEL_NUM ? names[resolveKernel(kernel)] : "unknown";
+}
+
+void ResizeConvertPlan::update(const cv::Size& src_size, const cv::Size& dst_size) {
+    if(isPlannedFor(src_size, dst_size)) {
+        return;
+    }
+    this->src_size = src_size;
+    this->dst_size = dst_size;
+    computeTaps(src_size.width, dst_size.width, x_first, x_second, x_weights);
+    computeTaps(src_size.height, dst_size.height, y_first, y_second, y_weights);
+    for(int x = 0; x < dst_size.width; x++) {
+        x_first[x] *= 3;
+        x_second[x] *= 3;
+    }
+}
+
+void resizeConvert(const cv::Mat& src, cv::Mat& dst, bool is_swap_rb,
+                   const ResizeConvertPlan& plan, ResizeKernel kernel) {
+    CV_Assert(src.type() == CV_8UC3 && dst.type() == CV_8UC3);
+    CV_Assert(plan.isPlannedFor(src.size(), dst.size()));
+    kernel = resolveKernel(kernel);
+
+    cv::parallel_for_(cv::Range(0, dst.rows), [&](const cv::Range& range) {
+        // The two filtered rows in use, each source row is filtered once per stripe. The
+        // rows stay with the worker thread, so they are only allocated for a larger width.
+        int count = dst.cols * 3;
+        static thread_local std::vector<short> rows[2];
+        for(auto& row : rows) {
+            if(row.size() < static_cast<size_t>(count)) {
+                row.resize(count);
+            }
+        }
+        int cached[2] = { -1, -1 };
+        auto filter = [&](int slot, int y) {
+            filterRow(src.ptr(y), rows[slot].data(), plan.x_first.data(), plan.x_second.data(),
+                      plan.x_weights.data(), dst.cols, is_swap_rb);
+            cached[slot] = y;
+        };
+
+        for(int y = range.start; y < range.end; y++) {
+            int y0 = plan.y_first[y];
+            int y1 = plan.y_second[y];
+            if(cached[0] != y0) {
+                if(cached[1] == y0) {
+                    rows[0].swap(rows[1]);
+                    std::swap(cached[0], cached[1]);
+                }
+                else {
+                    filter(0, y0);
+                }
+            }
+            if(cached[1] != y1) {
+                filter(1, y1);
+            }
+            blendRows(kernel, rows[0].data(), rows[1].data(), plan.y_weights[y], dst.ptr(y), 
+                      count);
+        }
+    });
+}
@@ -0,0 +1,72 @@
+#ifndef H_WLF_F3A10EC6_E002_495D_A0C4_C5EC8FEC18E3
+#define H_WLF_F3A10EC6_E002_495D_A0C4_C5EC8FEC18E3
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief The implementations of resizeConvert(), the best one the CPU runs is the default.
+ */
+enum ResizeKernel : uint8_t {
+    RESIZE_KERNEL_AUTO,
+    RESIZE_KERNEL_SCALAR,
+    RESIZE_KERNEL_SSE41,
+    RESIZE_KERNEL_AVX2,
+    RESIZE_KERNEL_NUM
+};
+
+/**
+ * @brief Whether the CPU runs the kernel.
+ */
+bool isResizeKernelSupported(ResizeKernel kernel);
+
+/**
+ * @brief Get the name of the kernel, AUTO is resolved to the one it runs.
+ */
+const char* getResizeKernelName(ResizeKernel kernel);
+
+/**
+ * @brief The taps of resizeConvert() for a source and a destination size, worked out once
+ * and reused for every frame of that geometry.
+ */
+struct ResizeConvertPlan {
+    /**
+     * @brief Work out the taps for the sizes, nothing is done if they are planned already.
+     */
+    void update(const cv::Size& src_size, const cv::Size& dst_size);
+
+    bool isPlannedFor(const cv::Size& src_size, const cv::Size& dst_size) const {
+        return this->src_size == src_size && this->dst_size == dst_size;
+    }
+
+    cv::Size src_size;              ///< The source size planned for, empty before update().
+    cv::Size dst_size;              ///< The destination size planned for.
+    std::vector<int>   x_first;     ///< The byte offset of the left tap of each column.
+    std::vector<int>   x_second;    ///< The byte offset of the right tap of each column.
+    std::vector<short> x_weights;   ///< The weight of the right tap, out of 128.
+    std::vector<int>   y_first;     ///< The upper source row of each row.
+    std::vector<int>   y_second;    ///< The lower source row of each row.
+    std::vector<short> y_weights;   ///< The weight of the lower row, out of 128.
+};
+
+/**
+ * @brief Resize an 8-bit 3-channel image bilinearly into dst, swapping the red and blue
+ * channels on the way if asked, in a single pass over the source.
+ *
+ * It replaces cv::cvtColor followed by cv::resize into a region of a canvas, which runs
+ * over the image three times. Each source row is filtered horizontally once, with the
+ * channel swap, into a row cache, and the rows are blended vertically with AVX2 or SSE4.1
+ * straight into dst. The weights have 7 bits, so the result differs from cv::resize with
+ * cv::INTER_LINEAR by at most 2, on the sharpest edges only. Nothing is allocated per
+ * call, the row caches belong to the worker threads.
+ * @param src The source image, CV_8UC3.
+ * @param dst The destination, CV_8UC3 of the size to resize to, usually a region of a
+ * canvas. It is written and never reallocated.
+ * @param is_swap_rb Swap the red and the blue channels.
+ * @param plan The taps, updated for the sizes of src and dst beforehand. It is only read,
+ * so several calls can share it.
+ * @param kernel Force an implementation, for comparing them.
+ */
+void resizeConvert(const cv::Mat& src, cv::Mat& dst, bool is_swap_rb,
+                   const ResizeConvertPlan& plan, ResizeKernel kernel = RESIZE_KERNEL_AUTO);
+
+#endif /* H_WLF_F3A10EC6_E002_495D_A0C4_C5EC8FEC18E3 */
@@ -0,0 +1,30 @@
+#ifndef H_WLF_252BF947_DC99_496F_961A_6DA2717078B3
+#define H_WLF_252BF947_DC99_496F_961A_6DA2717078B3
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief The two eyes of one moment, published and taken as one unit.
+ *
+ * The eyes are views into image, so a side-by-side frame is decoded once into image and
+ * never copied or split into separate buffers.
+ */
+struct StereoFrame {
+    cv::Mat image;      ///< The backing frame, side by side or mono.
+    cv::Mat eye[2];     ///< The views of the left and the right eye, the right one empty for mono.
+
+    /**
+     * @brief Point the eye views into image, the left and right halves unless is_mono.
+     */
+    void split(bool is_mono) {
+        if(is_mono) {
+            eye[0] = image;
+            eye[1] = cv::Mat();
+        }
+        else {
+            eye[0] = image.colRange(0, image.cols / 2);
+            eye[1] = image.colRange(image.cols / 2, image.cols);
+        }
+    }
+};
+
+#endif /* H_WLF_252BF947_DC99_496F_961A_6DA2717078B3 */
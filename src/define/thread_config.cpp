@@ -0,0 +1,258 @@
+#include "thread_config.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace {
+    const char* ROLE_NAMES[THREAD_ROLE_NUM] = { "capture", "decode", "display", "writer" };
+
+    /**
+     * @brief A thread that applied its configuration.
+     */
+    struct ThreadEntry {
+        std::string name;
+        pid_t       tid;
+    };
+    std::mutex               registry_mutex;
+    std::vector<ThreadEntry> registry;
+
+    pid_t getThreadId() {
+        return static_cast<pid_t>(syscall(SYS_gettid));
+    }
+
+    const char* getPolicyName(int policy) {
+        switch (policy)
+        {
+        case SCHED_FIFO:
+            return "SCHED_FIFO";
+        case SCHED_RR:
+            return "SCHED_RR";
+        default:
+            return "SCHED_OTHER";
+        }
+    }
+
+    std::string getCpuList(pid_t tid) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(tid, sizeof(set), &set) != 0) {
+            return "?";
+        }
+        std::string list;
+        int count = 0;
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if(CPU_ISSET(cpu, &set)) {
+                list += (count++ ? "," : "") + std::to_string(cpu);
+            }
+        }
+        return count == sysconf(_SC_NPROCESSORS_ONLN) ? "all" : list;
+    }
+
+    /**
+     * @brief Read the context switches of a thread from /proc.
+     */
+    bool getSwitches(pid_t tid, long& voluntary, long& involuntary) {
+        std::ifstream status("/proc/self/task/" + std::to_string(tid) + "/status");
+        std::string line;
+        int found = 0;
+        while(std::getline(status, line)) {
+            if(sscanf(line.c_str(), "voluntary_ctxt_switches: %ld", &voluntary) == 1) {
+                found++;
+            }
+            else if(sscanf(line.c_str(), "nonvoluntary_ctxt_switches: %ld", &involuntary) == 1) {
+                found++;
+            }
+        }
+        return found == 2;
+    }
+
+    /**
+     * @brief Parse a whole string as an integer, nothing may follow it.
+     */
+    bool parseInt(const std::string& str, int& value) {
+        if(str.empty()) {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long result = strtol(str.c_str(), &end, 10);
+        if(errno != 0 || *end != '\0' || result < INT_MIN || result > INT_MAX) {
+            return false;
+        }
+        value = static_cast<int>(result);
+        return true;
+    }
+
+    /**
+     * @brief Parse the cores, e.g. 2,3 or 4-7, each one must fit in a cpu_set_t.
+     */
+    bool parseCpus(const std::string& str, std::vector<int>& cpus) {
+        std::stringstream ss(str);
+        std::string item;
+        while(std::getline(ss, item, ',')) {
+            size_t dash = item.find('-');
+            int first = 0, last = 0;
+            if(!parseInt(item.substr(0, dash), first)) {
+                return false;
+            }
+            if(dash == std::string::npos) {
+                last = first;
+            }
+            else if(!parseInt(item.substr(dash + 1), last)) {
+                return false;
+            }
+            if(first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for(int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+        return !cpus.empty();
+    }
+}
+
+
+ThreadConfig::ThreadConfig()
+    : policy(SCHED_OTHER)
+    , priority(0) {
+}
+
+bool parseThreadConfig(const std::string& argstr, ThreadTopology& topology) {
+    size_t eq = argstr.find('=');
+    if(eq == std::string::npos) {
+        return false;
+    }
+    std::string role_name = argstr.substr(0, eq);
+    int role = 0;
+    while(role < THREAD_ROLE_NUM && role_name != ROLE_NAMES[role]) {
+        role++;
+    }
+    if(role == THREAD_ROLE_NUM) {
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream ss(argstr.substr(eq + 1));
+    std::string field;
+    while(std::getline(ss, field, '/')) {
+        fields.push_back(field);
+    }
+
+    ThreadConfig config;
+    if(fields.size() > 0 && !fields[0].empty() && !parseCpus(fields[0], config.cpus)) {
+        return false;
+    }
+    if(fields.size() > 1) {
+        if(fields[1] == "fifo") {
+            config.policy = SCHED_FIFO;
+        }
+        else if(fields[1] == "rr") {
+            config.policy = SCHED_RR;
+        }
+        else if(fields[1] != "other") {
+            return false;
+        }
+    }
+    // The real-time priorities are in the range of the policy, the nice values in -20..19
+    int min_priority = config.policy == SCHED_OTHER ? -20 : sched_get_priority_min(config.policy);
+    int max_priority = config.policy == SCHED_OTHER ? 19 : sched_get_priority_max(config.policy);
+    if(fields.size() > 2) {
+        if(!parseInt(fields[2], config.priority) || config.priority < min_priority
+           || config.priority > max_priority) {
+            printf("ThreadConfig: the priority of %s must be in %d..%d.\n", 
+                   getPolicyName(config.policy), min_priority, max_priority);
+            return false;
+        }
+    }
+    else if(config.policy != SCHED_OTHER) {
+        config.priority = min_priority;
+    }
+
+    topology.roles[role] = config;
+    printf("ThreadConfig: specify %s threads with cpus [%s], %s, priority %d.\n",
+           ROLE_NAMES[role], fields.empty() ? "" : fields[0].c_str(),
+           getPolicyName(config.policy), config.priority);
+    return true;
+}
+
+void printThreadArgDesc() {
+    printf("\t\t -a [role=cpus/policy/priority]\tPin and schedule the threads of a role\n"
+           "\t\t     role      capture, decode, display or writer\n"
+           "\t\t     cpus      the cores, e.g. 2,3 or 4-7, empty for any core\n"
+           "\t\t     policy    other (default), fifo or rr\n"
+           "\t\t     priority  1-99 for fifo and rr, the nice value -20..19 for other\n"
+           "\t\t   NOTE, each role is specified by using '-a' consecutively.\n"
+           );
+}
+
+void applyThreadConfig(const ThreadTopology& topology, ThreadRole role, const std::string& name) {
+    const ThreadConfig& config = topology.roles[role];
+    pid_t tid = getThreadId();
+    // The system name is at most 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    if(!config.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu : config.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if(err != 0) {
+            printf("ThreadConfig: cannot pin %s, %s.\n", name.c_str(), strerror(err));
+        }
+    }
+
+    if(config.policy == SCHED_OTHER) {
+        // The nice value is per thread on Linux
+        if(config.priority != 0 && setpriority(PRIO_PROCESS, tid, config.priority) != 0) {
+            printf("ThreadConfig: cannot set the nice value of %s, %s.\n",
+                   name.c_str(), strerror(errno));
+        }
+    }
+    else {
+        sched_param param;
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(pthread_self(), config.policy, &param);
+        if(err != 0) {
+            printf("ThreadConfig: cannot set %s of %s, %s.\n", getPolicyName(config.policy),
+                   name.c_str(), strerror(err));
+        }
+    }
+
+    int policy = SCHED_OTHER;
+    sched_param param;
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    printf("ThreadConfig: %s [%d] runs on cpus [%s], %s, priority %d.\n", name.c_str(), tid,
+           getCpuList(tid).c_str(), getPolicyName(policy),
+           policy == SCHED_OTHER ? getpriority(PRIO_PROCESS, tid) : param.sched_priority);
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(ThreadEntry{name, tid});
+}
+
+void printThreadReport() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    printf("ThreadConfig: [%zu] threads.\n", registry.size());
+    for(const auto& entry : registry) {
+        long voluntary = 0, involuntary = 0;
+        if(!getSwitches(entry.tid, voluntary, involuntary)) {
+            printf("\t%-16s [%d] exited.\n", entry.name.c_str(), entry.tid);
+            continue;
+        }
+        printf("\t%-16s [%d] cpus [%s], [%ld] preemptions, [%ld] voluntary switches.\n",
+               entry.name.c_str(), entry.tid, getCpuList(entry.tid).c_str(),
+               involuntary, voluntary);
+    }
+}
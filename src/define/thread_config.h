@@ -0,0 +1,72 @@
+#ifndef H_WLF_11292353_7C2B_48BB_81D9_E5656B935A48
+#define H_WLF_11292353_7C2B_48BB_81D9_E5656B935A48
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The kinds of threads of the viewers, each configured on its own.
+ */
+enum ThreadRole : uint8_t {
+    THREAD_CAPTURE,     ///< Reads the cameras or the video.
+    THREAD_DECODE,      ///< Decodes the camera frames, if not done by the capture thread.
+    THREAD_DISPLAY,     ///< Shows the frames, the main thread.
+    THREAD_WRITER,      ///< Writes the recordings.
+    THREAD_ROLE_NUM
+};
+
+/**
+ * @brief The placement and the scheduling of the threads of a role.
+ */
+struct ThreadConfig {
+    ThreadConfig();
+
+    std::vector<int> cpus;      ///< The cores to run on, any core if empty.
+    int         policy;         ///< SCHED_OTHER (default), SCHED_FIFO or SCHED_RR.
+    int         priority;       ///< 1-99 for SCHED_FIFO/SCHED_RR, the nice value for SCHED_OTHER.
+};
+
+/**
+ * @brief The thread configuration of all the roles, the default one leaves the threads
+ * to the scheduler.
+ */
+struct ThreadTopology {
+    ThreadConfig roles[THREAD_ROLE_NUM];    ///< By ThreadRole.
+};
+
+/**
+ * @brief Parse the configuration of a role, as "role=cpus[/policy[/priority]]".
+ *
+ * For example "capture=2,3/fifo/80" or "display=4-5/other/-10".
+ * @param argstr The input arguments from main().
+ * @param topology The topology to set the role of.
+ * @return
+ *   @retval true For parsed successfully.
+ *   @retval false For failed.
+ */
+bool parseThreadConfig(const std::string& argstr, ThreadTopology& topology);
+
+/**
+ * @brief Print description of thread argument.
+ */
+void printThreadArgDesc();
+
+/**
+ * @brief Apply the configuration of the role to the calling thread and register the thread
+ * for printThreadReport().
+ *
+ * A setting the process is not allowed to make, e.g. SCHED_FIFO without CAP_SYS_NICE, is
+ * reported and skipped, the thread still runs.
+ * @param topology The thread configuration.
+ * @param role The role of the calling thread.
+ * @param name The name of the thread in the reports, also set as its system name.
+ */
+void applyThreadConfig(const ThreadTopology& topology, ThreadRole role, const std::string& name);
+
+/**
+ * @brief Print the affinity, the scheduling and the context switches of every registered
+ * thread. The involuntary switches are the preemptions.
+ */
+void printThreadReport();
+
+#endif /* H_WLF_11292353_7C2B_48BB_81D9_E5656B935A48 */
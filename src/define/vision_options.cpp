@@ -101,10 +101,34 @@ const char* DisplayScreen::c_str() const {
     return info;
 }
 
+bool parseCameraBackend(const std::string& name, CameraBackend& backend) {
+    static const std::vector<std::string> names = { "opencv", "v4l2", "synthetic", "replay" };
+    for(size_t i = 0; i < names.size(); i++) {
+        if(name == names[i]) {
+            backend = static_cast<CameraBackend>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+CameraViewerOption::CameraViewerOption() 
+    : is_mono(true)
+    , index{0, 1}
+    , imwidth(1920)
+    , imheight(1080)
+    , backend(CAMERA_OPENCV)
+    , is_latest_only(false)
+    , replay_prefix("")
+    , is_replay_realtime(true)
+    , record_policy(RECORD_BLOCK) {
+}
+
 VideoViewerOption::VideoViewerOption() 
     : video_path("")
     , is_mono(false)
     , is_looped(true)
     , is_bgr(false)
-    , interval(0) {
+    , interval(0)
+    , record_policy(RECORD_BLOCK) {
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include "thread_config.h"
+#include "record_queue.h"
 
 /**
  * @brief Supported screen resolution.
@@ -64,14 +66,44 @@ bool parseScreenInfo(std::string argstr, std::vector<DisplayScreen>& screens);
  */
 void printScreenArgDesc();
 
+/**
+ * @brief Supported camera capture backends.
+ */
+enum CameraBackend : uint8_t {
+    CAMERA_OPENCV,      ///< cv::VideoCapture.
+    CAMERA_V4L2,        ///< V4L2 mmap capture with libjpeg-turbo decoding.
+    CAMERA_SYNTHETIC,   ///< Generated test pattern, no camera required.
+    CAMERA_REPLAY,      ///< Capture dumps of endo_v4l_cv, decoded like V4L2 frames.
+    CAMERA_BACKEND_NUM
+};
+
+/**
+ * @brief Parse the camera backend from its name, "opencv", "v4l2", "synthetic" or "replay".
+ * 
+ * @param name The given name.
+ * @param backend The parsed backend.
+ * @return 
+ *   @retval true For parsed successfully.
+ *   @retval false For an unknown name.
+ */
+bool parseCameraBackend(const std::string& name, CameraBackend& backend);
+
 /**
  * @brief The settable options for VisionViewer.
  */
 struct CameraViewerOption {
+    CameraViewerOption();
+
     bool        is_mono;        ///< Specify the monocular or binocular.
     uint8_t     index[2];       ///< Specify the camera index.
     uint16_t    imwidth;        ///< Image width, required in camera mode.
     uint16_t    imheight;       ///< Image height, required in camera mode.
+    CameraBackend backend;      ///< The capture backend, OpenCV is default.
+    bool        is_latest_only; ///< Keep only the newest frame queued, for the lowest latency.
+    std::string replay_prefix;  ///< Replay <prefix>_<0/1>.v4ldump of the left and right eye.
+    bool        is_replay_realtime; ///< Replay with the recorded timing, true is default.
+    ThreadTopology threads;     ///< The cores and the scheduling of the threads.
+    RecordPolicy record_policy; ///< When the writer lags, block (default) or drop frames.
     
     std::vector<DisplayScreen> screens; ///< Display screens.
 };
@@ -87,6 +119,8 @@ struct VideoViewerOption {
     bool        is_looped;      ///< Specify to loop the displaying, looping is default.
     bool        is_bgr;         ///< Sepcify the video color pattern, RGB is default.
     int         interval;       ///< Specify the refresh interval in milliseconds.
+    ThreadTopology threads;     ///< The cores and the scheduling of the threads.
+    RecordPolicy record_policy; ///< When the writer lags, block (default) or drop frames.
 
     std::vector<DisplayScreen> screens; ///< Display screens.
 };
@@ -0,0 +1,42 @@
+#include "frame_source.h"
+#include "opencv_source.h"
+#include "synthetic_source.h"
+#include "v4l2_source.h"
+#include "replay_source.h"
+
+std::unique_ptr<FrameSource> createVideoSource(const std::string& path) {
+    return std::unique_ptr<FrameSource>(new VideoFileSource(path));
+}
+
+std::unique_ptr<FrameSource> createCameraSource(CameraBackend backend, int index,
+                                                int width, int height,
+                                                bool is_latest_only) {
+    switch (backend)
+    {
+    case CAMERA_OPENCV:
+        return std::unique_ptr<FrameSource>(new OpenCVCameraSource(index, width, height, is_latest_only));
+    case CAMERA_V4L2:
+#if HAVE_V4L2_CAPTURE
+        return std::unique_ptr<FrameSource>(new V4L2CameraSource(index, width, height, is_latest_only));
+#else
+        printf("FrameSource: the V4L2 backend is not built in, enable WITH_V4L2_CAPTURE.\n");
+        return nullptr;
+#endif
+    case CAMERA_SYNTHETIC:
+        return std::unique_ptr<FrameSource>(new SyntheticSource(index, width, height));
+    case CAMERA_REPLAY:
+        printf("FrameSource: a replay is created by createReplaySource().\n");
+        return nullptr;
+    default:
+        return nullptr;
+    }
+}
+
+std::unique_ptr<FrameSource> createReplaySource(const std::string& path, bool is_realtime) {
+#if HAVE_V4L2_CAPTURE
+    return std::unique_ptr<FrameSource>(new ReplaySource(path, is_realtime));
+#else
+    printf("FrameSource: the replay needs the V4L2 backend, enable WITH_V4L2_CAPTURE.\n");
+    return nullptr;
+#endif
+}
@@ -0,0 +1,97 @@
+#ifndef H_WLF_8935A513_8FC5_4457_A3E7_0B31EC3FCD60
+#define H_WLF_8935A513_8FC5_4457_A3E7_0B31EC3FCD60
+#include <memory>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "../define/vision_options.h"
+
+/**
+ * @brief The result of FrameSource::read().
+ */
+enum ReadStatus {
+    READ_OK,        ///< A new frame.
+    READ_DROPPED,   ///< A frame was lost, e.g. a corrupt one, the source goes on.
+    READ_END,       ///< The end of a video.
+    READ_ERROR,     ///< The capture failed, the source has to be opened again.
+};
+
+/**
+ * @brief The interface of everything VisionViewer reads frames from.
+ *
+ * All sources deliver 8-bit BGR images, the layout cv::imshow and cv::VideoWriter take.
+ * A source is used by one reading thread only.
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    /**
+     * @brief Open the source, it can be opened again after release().
+     */
+    virtual bool open() = 0;
+
+    /**
+     * @brief Read the next frame, a live source blocks until the frame is captured.
+     *
+     * @param frame The read frame, its buffer is reused when the size matches.
+     * @return READ_OK for a new frame, READ_DROPPED if only this frame is lost.
+     */
+    virtual ReadStatus read(cv::Mat& frame) = 0;
+
+    /**
+     * @brief Close the source.
+     */
+    virtual void release() = 0;
+
+    /**
+     * @brief Restart from the first frame, only recorded sources support it.
+     */
+    virtual bool rewind() { return false; }
+
+    /**
+     * @brief The image size, valid once opened.
+     */
+    virtual cv::Size getSize() const = 0;
+
+    /**
+     * @brief The nominal frame rate, 0 if unknown.
+     */
+    virtual double getFPS() const = 0;
+
+    /**
+     * @brief A name for logging, e.g. "v4l2:/dev/video0".
+     */
+    virtual std::string getName() const = 0;
+};
+
+/**
+ * @brief Create a source reading a video file.
+ *
+ * @param path The path of the video.
+ */
+std::unique_ptr<FrameSource> createVideoSource(const std::string& path);
+
+/**
+ * @brief Create a source of a live camera.
+ *
+ * @param backend The capture backend.
+ * @param index   The camera index, /dev/video<index>.
+ * @param width   The requested image width.
+ * @param height  The requested image height.
+ * @param is_latest_only Drop queued frames in favour of the newest one.
+ * @return nullptr if the backend is not built in.
+ */
+std::unique_ptr<FrameSource> createCameraSource(CameraBackend backend, int index,
+                                                int width, int height,
+                                                bool is_latest_only = false);
+
+/**
+ * @brief Create a source replaying a capture dump of endo_v4l_cv.
+ *
+ * @param path        The dump file.
+ * @param is_realtime Keep the recorded frame timing, otherwise replay at maximum speed.
+ * @return nullptr if the V4L2 backend is not built in.
+ */
+std::unique_ptr<FrameSource> createReplaySource(const std::string& path, bool is_realtime);
+
+#endif /* H_WLF_8935A513_8FC5_4457_A3E7_0B31EC3FCD60 */
@@ -0,0 +1,64 @@
+#include "opencv_source.h"
+
+VideoFileSource::VideoFileSource(const std::string& path)
+    : _path(path)
+    , _fps(0) {
+}
+
+bool VideoFileSource::open() {
+    if(!_capture.open(_path)) {
+        return false;
+    }
+    _size = cv::Size(_capture.get(cv::CAP_PROP_FRAME_WIDTH),
+                     _capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    _fps = _capture.get(cv::CAP_PROP_FPS);
+    return true;
+}
+
+ReadStatus VideoFileSource::read(cv::Mat& frame) {
+    return _capture.read(frame) ? READ_OK : READ_END;
+}
+
+void VideoFileSource::release() {
+    _capture.release();
+}
+
+bool VideoFileSource::rewind() {
+    return _capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+}
+
+
+OpenCVCameraSource::OpenCVCameraSource(int index, int width, int height, bool is_latest_only)
+    : _index(index)
+    , _size(width, height)
+    , _is_latest_only(is_latest_only) {
+}
+
+bool OpenCVCameraSource::open() {
+    if(!_capture.open(_index)) {
+        return false;
+    }
+    _capture.set(cv::CAP_PROP_FOURCC, cv::CAP_OPENCV_MJPEG);
+    _capture.set(cv::CAP_PROP_FRAME_WIDTH, _size.width);
+    _capture.set(cv::CAP_PROP_FRAME_HEIGHT, _size.height);
+    _capture.set(cv::CAP_PROP_BUFFERSIZE, _is_latest_only ? 1 : 3);
+    // _capture.set(cv::CAP_PROP_SHARPNESS, 3);
+    _size = cv::Size(_capture.get(cv::CAP_PROP_FRAME_WIDTH),
+                     _capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    return true;
+}
+
+ReadStatus OpenCVCameraSource::read(cv::Mat& frame) {
+    if(!_capture.read(frame)) {
+        return READ_ERROR;
+    }
+    return frame.empty() ? READ_DROPPED : READ_OK;
+}
+
+void OpenCVCameraSource::release() {
+    _capture.release();
+}
+
+double OpenCVCameraSource::getFPS() const {
+    return _capture.get(cv::CAP_PROP_FPS);
+}
@@ -0,0 +1,53 @@
+#ifndef H_WLF_11353F35_89E2_4295_898E_C53DDEA13F7C
+#define H_WLF_11353F35_89E2_4295_898E_C53DDEA13F7C
+#include "frame_source.h"
+
+/**
+ * @brief A video file read by cv::VideoCapture.
+ */
+class VideoFileSource : public FrameSource {
+public:
+    explicit VideoFileSource(const std::string& path);
+
+    bool open() override;
+    ReadStatus read(cv::Mat& frame) override;
+    void release() override;
+    bool rewind() override;
+    cv::Size getSize() const override { return _size; }
+    double getFPS() const override { return _fps; }
+    std::string getName() const override { return "video:" + _path; }
+
+private:
+    std::string      _path;     ///< The path of the video.
+    cv::VideoCapture _capture;  ///< The OpenCV capture.
+    cv::Size         _size;     ///< The image size.
+    double           _fps;      ///< The frame rate stored in the video.
+};
+
+
+/**
+ * @brief A camera captured by cv::VideoCapture in MJPEG.
+ */
+class OpenCVCameraSource : public FrameSource {
+public:
+    /**
+     * @param is_latest_only Keep one frame queued in the backend instead of three, OpenCV
+     *                       has no way to drain the queue itself.
+     */
+    OpenCVCameraSource(int index, int width, int height, bool is_latest_only = false);
+
+    bool open() override;
+    ReadStatus read(cv::Mat& frame) override;
+    void release() override;
+    cv::Size getSize() const override { return _size; }
+    double getFPS() const override;
+    std::string getName() const override { return "opencv:" + std::to_string(_index); }
+
+private:
+    int              _index;    ///< The camera index.
+    cv::Size         _size;     ///< The requested image size, the actual one once opened.
+    bool             _is_latest_only;   ///< Keep a single frame queued.
+    cv::VideoCapture _capture;  ///< The OpenCV capture.
+};
+
+#endif /* H_WLF_11353F35_89E2_4295_898E_C53DDEA13F7C */
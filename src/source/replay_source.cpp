@@ -0,0 +1,96 @@
+#include "replay_source.h"
+#if HAVE_V4L2_CAPTURE
+#include "../../endo_v4l_cv/src/inc/v4l2_capture.h"
+#include "../../endo_v4l_cv/src/inc/capture_dump.h"
+
+ReplaySource::ReplaySource(const std::string& path, bool is_realtime)
+    : _path(path)
+    , _is_realtime(is_realtime)
+    , _fps(0)
+    , _capture(nullptr)
+    , _reader(new CaptureDumpReader())
+    , _buffer(new CaptureDumpFrame())
+    , _next(0)
+    , _decode_time(0) {
+}
+
+ReplaySource::~ReplaySource() {
+    release();
+    delete _reader;
+    delete _buffer;
+}
+
+bool ReplaySource::open() {
+    release();
+    if(!_reader->open(_path) || _reader->getFrameCount() == 0) {
+        return false;
+    }
+    const auto& format = _reader->getFormat();
+    _size = cv::Size(format.width, format.height);
+    _capture = new V4L2Capture(format.width, format.height, 3,
+                               V4L2Capture::STREAM_MJPEG, true);
+    _capture->openReplay(format.pixel_format, format.bytes_per_line);
+
+    // The recorded rate, from the first and the last timestamp
+    CaptureDumpFrame last;
+    unsigned int count = _reader->getFrameCount();
+    if(count > 1 && _reader->read(0, *_buffer) && _reader->read(count - 1, last)
+       && last.timestamp_us > _buffer->timestamp_us) {
+        _fps = (count - 1) * 1e6 / (last.timestamp_us - _buffer->timestamp_us);
+        _clock.setFPS(_fps);
+    }
+    printf("ReplaySource: %s, %u frames of %dx%d, %.1f FPS recorded.\n", _path.c_str(),
+           count, _size.width, _size.height, _fps);
+    return rewind();
+}
+
+ReadStatus ReplaySource::read(cv::Mat& frame) {
+    if(_capture == nullptr) {
+        return READ_ERROR;
+    }
+    if(_next >= _reader->getFrameCount()) {
+        double total_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - _start).count();
+        double decode_ms = std::chrono::duration<double, std::milli>(_decode_time).count();
+        printf("ReplaySource: %u frames in %.0f ms, %.1f FPS, decode [%.2f]ms per frame.\n",
+               _next, total_ms, _next * 1000. / total_ms, decode_ms / _next);
+        if(_is_realtime) {
+            _clock.printStats("ReplaySource");
+        }
+        rewind();
+    }
+    if(!_reader->read(_next, *_buffer)) {
+        return READ_ERROR;
+    }
+
+    if(_next == 0) {
+        _start = std::chrono::steady_clock::now();
+        _clock.reset();
+    }
+    if(_is_realtime) {
+        _clock.waitTimestamp(_buffer->timestamp_us);
+    }
+    _next++;
+
+    frame.create(_size, CV_8UC3);
+    auto time_start = std::chrono::steady_clock::now();
+    bool is_decoded = _capture->decodePayload(_buffer->payload.data(), _buffer->payload.size(),
+                                              frame.data, frame.step);
+    _decode_time += std::chrono::steady_clock::now() - time_start;
+    // A corrupt recorded frame is skipped, the position in the dump goes on
+    return is_decoded ? READ_OK : READ_DROPPED;
+}
+
+void ReplaySource::release() {
+    delete _capture;
+    _capture = nullptr;
+    _reader->close();
+}
+
+bool ReplaySource::rewind() {
+    _next = 0;
+    _decode_time = std::chrono::steady_clock::duration(0);
+    return true;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef H_WLF_5CDA959E_6D35_409D_9CF2_F539FEDD69D5
+#define H_WLF_5CDA959E_6D35_409D_9CF2_F539FEDD69D5
+#include <chrono>
+#include "frame_source.h"
+#include "../define/frame_clock.h"
+
+class V4L2Capture;
+class CaptureDumpReader;
+struct CaptureDumpFrame;
+
+/**
+ * @brief Replays a capture dump of endo_v4l_cv through the decode path of V4L2Capture.
+ *
+ * The recorded buffers are decoded exactly like live ones, so the decode and display
+ * stages can be measured without cameras. At the end of the dump the decode time and the
+ * achieved frame rate are printed, and the replay starts over.
+ * Only built with HAVE_V4L2_CAPTURE, see the WITH_V4L2_CAPTURE option of CMake.
+ */
+class ReplaySource : public FrameSource {
+public:
+    /**
+     * @param path        The dump file.
+     * @param is_realtime Keep the recorded frame timing, otherwise replay at maximum speed.
+     */
+    ReplaySource(const std::string& path, bool is_realtime);
+    ~ReplaySource();
+
+    bool open() override;
+    ReadStatus read(cv::Mat& frame) override;
+    void release() override;
+    bool rewind() override;
+    cv::Size getSize() const override { return _size; }
+    double getFPS() const override { return _fps; }
+    std::string getName() const override { return "replay:" + _path; }
+
+private:
+    std::string         _path;          ///< The dump file.
+    bool                _is_realtime;   ///< Keep the recorded frame timing.
+    cv::Size            _size;          ///< The image size.
+    double              _fps;           ///< The recorded frame rate.
+    V4L2Capture*        _capture;       ///< Decodes with the recorded stream format.
+    CaptureDumpReader*  _reader;        ///< The dump.
+    CaptureDumpFrame*   _buffer;        ///< The payload being decoded.
+    unsigned int        _next;          ///< The index of the next frame.
+    FrameClock          _clock;         ///< Keeps the recorded timing.
+    std::chrono::steady_clock::time_point _start;   ///< When the first frame was read.
+    std::chrono::steady_clock::duration   _decode_time; ///< The decode time of this pass.
+};
+
+#endif /* H_WLF_5CDA959E_6D35_409D_9CF2_F539FEDD69D5 */
@@ -0,0 +1,41 @@
+#include "synthetic_source.h"
+
+SyntheticSource::SyntheticSource(int index, int width, int height, double fps)
+    : _index(index)
+    , _size(width, height)
+    , _fps(fps)
+    , _count(0)
+    , _clock(fps) {
+}
+
+bool SyntheticSource::open() {
+    _background.create(_size, CV_8UC3);
+    for(int y = 0; y < _size.height; y++) {
+        uchar* row = _background.ptr(y);
+        for(int x = 0; x < _size.width; x++) {
+            row[3*x]     = (uchar)(x * 255 / _size.width);
+            row[3*x + 1] = (uchar)(y * 255 / _size.height);
+            row[3*x + 2] = (uchar)(255 - x * 255 / _size.width);
+        }
+    }
+    _count = 0;
+    _clock.reset();
+    return true;
+}
+
+ReadStatus SyntheticSource::read(cv::Mat& frame) {
+    if(_background.empty()) {
+        return READ_ERROR;
+    }
+    // Paced against absolute deadlines, so the rate does not drift
+    _clock.wait();
+
+    _background.copyTo(frame);
+    int bar_width = _size.width / 16;
+    int x = (int)((_count * 8 + _index * bar_width / 2) % (_size.width - bar_width));
+    cv::rectangle(frame, cv::Rect(x, 0, bar_width, _size.height), cv::Scalar(255, 255, 255), -1);
+    cv::putText(frame, std::to_string(_count), cv::Point(40, 80), cv::FONT_HERSHEY_SIMPLEX,
+                2, cv::Scalar(0, 0, 0), 3);
+    _count++;
+    return READ_OK;
+}
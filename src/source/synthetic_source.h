@@ -0,0 +1,32 @@
+#ifndef H_WLF_1FCD2B13_B5FE_406E_A634_98ACD7F1C7B6
+#define H_WLF_1FCD2B13_B5FE_406E_A634_98ACD7F1C7B6
+#include "frame_source.h"
+#include "../define/frame_clock.h"
+
+/**
+ * @brief A generated test pattern paced like a camera, for running without hardware.
+ *
+ * A colour gradient with a bar moving across it and the frame number. The bar of the
+ * camera with index 1 is shifted, so that a stereo pair shows some disparity.
+ */
+class SyntheticSource : public FrameSource {
+public:
+    SyntheticSource(int index, int width, int height, double fps = 60);
+
+    bool open() override;
+    ReadStatus read(cv::Mat& frame) override;
+    void release() override {}
+    cv::Size getSize() const override { return _size; }
+    double getFPS() const override { return _fps; }
+    std::string getName() const override { return "synthetic:" + std::to_string(_index); }
+
+private:
+    int         _index;         ///< The camera index.
+    cv::Size    _size;          ///< The image size.
+    double      _fps;           ///< The frame rate.
+    cv::Mat     _background;    ///< The static part of the pattern.
+    uint64_t    _count;         ///< The number of frames generated.
+    FrameClock  _clock;         ///< Paces the frames.
+};
+
+#endif /* H_WLF_1FCD2B13_B5FE_406E_A634_98ACD7F1C7B6 */
@@ -0,0 +1,54 @@
+#include "v4l2_source.h"
+#if HAVE_V4L2_CAPTURE
+#include "../../endo_v4l_cv/src/inc/v4l2_capture.h"
+
+V4L2CameraSource::V4L2CameraSource(int index, int width, int height, bool is_latest_only)
+    : _index(index)
+    , _size(width, height)
+    , _fps(0)
+    , _is_latest_only(is_latest_only)
+    , _capture(nullptr) {
+}
+
+V4L2CameraSource::~V4L2CameraSource() {
+    release();
+}
+
+bool V4L2CameraSource::open() {
+    release();
+    _capture = new V4L2Capture(_size.width, _size.height, 3,
+                               V4L2Capture::STREAM_MJPEG, true);
+    _capture->setLatestOnly(_is_latest_only);
+    if(!_capture->openDevice(_index)) {
+        release();
+        return false;
+    }
+    // The frames are decoded at the size the driver settled on
+    _size = cv::Size(_capture->getWidth(), _capture->getHeight());
+    _fps = _capture->getFPS();
+    return true;
+}
+
+ReadStatus V4L2CameraSource::read(cv::Mat& frame) {
+    if(_capture == nullptr) {
+        return READ_ERROR;
+    }
+    frame.create(_size, CV_8UC3);
+    // A frame the decoder rejects is lost alone, the stream itself is fine
+    bool is_corrupt = false;
+    if(_capture->ioctlDequeueBuffers(frame.data, frame.step, &is_corrupt)) {
+        return READ_OK;
+    }
+    return is_corrupt ? READ_DROPPED : READ_ERROR;
+}
+
+void V4L2CameraSource::release() {
+    if(_capture != nullptr && _is_latest_only) {
+        printf("V4L2CameraSource: /dev/video%d skipped [%u] older frames.\n", 
+               _index, _capture->getSkippedFrames());
+    }
+    delete _capture;
+    _capture = nullptr;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef H_WLF_76BCE188_88AC_45E5_B1BC_FFA7BB41D138
+#define H_WLF_76BCE188_88AC_45E5_B1BC_FFA7BB41D138
+#include "frame_source.h"
+
+class V4L2Capture;
+
+/**
+ * @brief A camera captured by V4L2Capture of endo_v4l_cv.
+ *
+ * The MJPEG frames are decoded by libjpeg-turbo straight from the mapped buffer into the
+ * frame, in BGR, without the copies and the conversion of cv::VideoCapture.
+ * Only built with HAVE_V4L2_CAPTURE, see the WITH_V4L2_CAPTURE option of CMake.
+ */
+class V4L2CameraSource : public FrameSource {
+public:
+    /**
+     * @param is_latest_only Drain the V4L2 queue and decode only the newest frame.
+     */
+    V4L2CameraSource(int index, int width, int height, bool is_latest_only = false);
+    ~V4L2CameraSource();
+
+    bool open() override;
+    ReadStatus read(cv::Mat& frame) override;
+    void release() override;
+    cv::Size getSize() const override { return _size; }
+    double getFPS() const override { return _fps; }
+    std::string getName() const override { return "v4l2:/dev/video" + std::to_string(_index); }
+
+private:
+    int          _index;    ///< The camera index.
+    cv::Size     _size;     ///< The requested image size, the negotiated one once opened.
+    double       _fps;      ///< The negotiated frame rate.
+    bool         _is_latest_only;   ///< Decode only the newest frame.
+    V4L2Capture* _capture;  ///< The capture, recreated by each open().
+};
+
+#endif /* H_WLF_76BCE188_88AC_45E5_B1BC_FFA7BB41D138 */
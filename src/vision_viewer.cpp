@@ -1,4 +1,7 @@
 #include "vision_viewer.h"
+#include "./define/frame_pool.h"
+#include "./define/hcompress.h"
+#include <algorithm>
 #include <thread>
 #include <stdexcept>
 
@@ -16,6 +19,11 @@ namespace {
             std::chrono::milliseconds>(now - start_time_point).count();
     }
 
+    double getMsSince(const std::chrono::steady_clock::time_point &start_time_point) {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start_time_point).count();
+    }
+
     inline std::string getCurrentTimeStr() {
         time_t timep;
         time(&timep);
@@ -33,14 +41,20 @@ VisionViewer::VisionViewer(const VideoViewerOption& option)
     : _mode(VIDEO)
     , _vid_option(option)
     , _should_stop(false)
-    , _should_write(false) {
+    , _should_write(false)
+    , _timestamp_file(nullptr)
+    , _written_count(0)
+    , _record_fps(30) {
 }
 
 VisionViewer::VisionViewer(const CameraViewerOption& option) 
     : _mode(CAMERA)
     , _cam_option(option)
     , _should_stop(false) 
-    , _should_write(false){
+    , _should_write(false)
+    , _timestamp_file(nullptr)
+    , _written_count(0)
+    , _record_fps(30) {
 }
 
 VisionViewer::~VisionViewer() {
@@ -48,6 +62,9 @@ VisionViewer::~VisionViewer() {
 }
 
 void VisionViewer::startShow() {
+    // Every frame buffer from here on comes from the pool
+    FramePool::install();
+
     // Parse screen info
     parseDisplayInfo();
 
@@ -72,11 +89,13 @@ void VisionViewer::startShow() {
         }
     }    
 
+    // The writer is joined, so that a recording is complete when the viewer quits
     std::thread write_thread;
     write_thread = std::thread(&VisionViewer::writeVideo, this);
-    write_thread.detach();
 
     show();
+    _should_stop = true;
+    write_thread.join();
 }
 
 void VisionViewer::parseDisplayInfo() {
@@ -106,6 +125,26 @@ void VisionViewer::parseDisplayInfo() {
         cv::setWindowProperty(info.win_name, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN);
     }
 
+    // The windows of the same geometry show one canvas, composed once per frame
+    _render_plans.clear();
+    for(const auto& info : _win_info_3d) {
+        auto iter = std::find_if(_render_plans.begin(), _render_plans.end(), 
+            [&info](const RenderPlan& plan) {
+                return plan.win_width == info.win_width && plan.win_height == info.win_height
+                       && plan.is_hcompress == info.is_hcompress;
+            });
+        if(iter == _render_plans.end()) {
+            RenderPlan plan;
+            plan.win_width = info.win_width;
+            plan.win_height = info.win_height;
+            plan.is_hcompress = info.is_hcompress;
+            plan.interpolation = cv::INTER_LINEAR;
+            _render_plans.push_back(plan);
+            iter = _render_plans.end() - 1;
+        }
+        iter->win_names.push_back(info.win_name);
+    }
+
     if(_win_names_2d.size() == 0 && _win_info_3d.size() == 0) {
         printf("VisionViewer: no screen is specified, app exit.\n");
         std::exit(-1);
@@ -114,130 +153,256 @@ void VisionViewer::parseDisplayInfo() {
         _win_names_2d.size(), _win_info_3d.size());
 }
 
+void VisionViewer::updateRenderPlan(RenderPlan& plan, const cv::Size& eye_size) {
+    // Fit the eye into a window, the rest are the bars
+    float scale = std::min(1.f * plan.win_width / eye_size.width, 
+                           1.f * plan.win_height / eye_size.height);
+    plan.eye_size = eye_size;
+    plan.dst_size = cv::Size(std::min<int>(round(eye_size.width * scale), plan.win_width),
+                             std::min<int>(round(eye_size.height * scale), plan.win_height));
+    // Linear is enough down to half the size, below that it aliases
+    plan.interpolation = scale < 0.5f ? cv::INTER_AREA : cv::INTER_LINEAR;
+
+    // H-compressed, both eyes are squeezed into one window width as the monitor expects
+    int half_width = plan.win_width;
+    if(plan.is_hcompress) {
+        half_width = plan.win_width / 2;
+        plan.dst_size.width = std::max(plan.dst_size.width / 2, 1);
+        plan.interpolation = scale < 1.f ? cv::INTER_AREA : cv::INTER_LINEAR;
+    }
+
+    plan.canvas = cv::Mat(plan.win_height, half_width*2, CV_8UC3, cv::Scalar(0, 0, 0));
+    int x_half_devia = (half_width - plan.dst_size.width) / 2;
+    int y_half_devia = (plan.win_height - plan.dst_size.height) / 2;
+    for(int i = 0; i < 2; i++) {
+        plan.dst[i] = plan.canvas(cv::Rect(x_half_devia + i*half_width, y_half_devia,
+                                           plan.dst_size.width, plan.dst_size.height));
+    }
+    // The taps of a swapped eye, not rebuilt for every frame
+    plan.convert_plan.update(eye_size, plan.dst_size);
+    printf("VisionViewer: 3D windows of %dx%d%s show the %dx%d eyes at %dx%d, [%zu] windows "
+           "share the canvas.\n", plan.win_width, plan.win_height, 
+           plan.is_hcompress ? " h-compressed" : "", eye_size.width, eye_size.height,
+           plan.dst_size.width, plan.dst_size.height, plan.win_names.size());
+}
+
+void VisionViewer::composeRenderPlans(const cv::Mat& imleft, const cv::Mat& imright, 
+                                      bool is_swap_rb, bool is_parallel) {
+    for(auto& plan : _render_plans) {
+        if(plan.eye_size != imleft.size()) {
+            updateRenderPlan(plan, imleft.size());
+        }
+    }
+
+    // Only the eye regions of the canvases are written, each one is a task on its own
+    const cv::Mat* eyes[2] = { &imleft, &imright };
+    auto composeEye = [&](int task) {
+        RenderPlan& plan = _render_plans[task / 2];
+        int i = task % 2;
+        // A swapped eye is converted, resized and put on the canvas in a single pass, only
+        // the area interpolation of a small window, or an eye of another size than the
+        // planned one, is left to OpenCV
+        bool is_planned = plan.convert_plan.isPlannedFor(eyes[i]->size(), plan.dst_size);
+        if(is_swap_rb && plan.interpolation != cv::INTER_AREA && is_planned) {
+            resizeConvert(*eyes[i], plan.dst[i], true, plan.convert_plan);
+        }
+        else if(is_swap_rb) {
+            cv::Mat swapped;
+            cv::cvtColor(*eyes[i], swapped, cv::COLOR_BGR2RGB);
+            cv::resize(swapped, plan.dst[i], plan.dst_size, 0, 0, plan.interpolation);
+        }
+        else if(plan.is_hcompress) {
+            resizeHalfWidth(*eyes[i], plan.dst[i], plan.interpolation);
+        }
+        else if(eyes[i]->size() == plan.dst_size) {
+            eyes[i]->copyTo(plan.dst[i]);
+        }
+        else {
+            cv::resize(*eyes[i], plan.dst[i], plan.dst_size, 0, 0, plan.interpolation);
+        }
+    };
+    int task_count = static_cast<int>(_render_plans.size()) * 2;
+    // A single canvas is better left to the row parallelism of the resize itself
+    if(is_parallel && _render_plans.size() > 1) {
+        cv::parallel_for_(cv::Range(0, task_count), [&](const cv::Range& range) {
+            for(int task = range.start; task < range.end; task++) {
+                composeEye(task);
+            }
+        }, task_count);
+    }
+    else {
+        for(int task = 0; task < task_count; task++) {
+            composeEye(task);
+        }
+    }
+}
+
 void VisionViewer::readVideoFrame() {
     auto& option = _vid_option;
-    auto& cap = _capture[0];
-    auto& tri_frame_prop = _tri_frame_prop[0];
+    auto& source = _source[0];
+    applyThreadRole(THREAD_CAPTURE, "read-video");
 
-    cap = cv::VideoCapture(option.video_path);
-    if(!cap.isOpened()) {
+    source = createVideoSource(option.video_path);
+    if(!source->open()) {
         std::ostringstream err;
         err << "VisionViewer: Unable to open input video file: " 
             << option.video_path << std::endl;
         throw std::invalid_argument(err.str());
     }
 
-    _imwidth = cap.get(cv::CAP_PROP_FRAME_WIDTH);
-    _imheight = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-    double fps = cap.get(cv::CAP_PROP_FPS);
+    _imwidth = source->getSize().width;
+    _imheight = source->getSize().height;
+    double fps = source->getFPS();
     printf("Video property: %d x %d resolution, with %f FPS\n", _imwidth, _imheight, fps);    
 
+    // The slots, and the frame read when there is no free one
+    FramePool::getInstance().reserve(size_t(_imwidth) * _imheight * 3, 
+                                     _stereo_frames.size() + 1);
+
+    // Paced at the exact rate of the file, a rounded interval would drift
     if(option.interval == 0) {
-        option.interval = (int)1000 / fps;
-        printf("      no extra refresh interval is specified, 1/FPS=%d is used.\n",
-                option.interval);
+        _read_clocks[0].setFPS(fps > 0 ? fps : 30);
+        printf("      no extra refresh interval is specified, 1/FPS=%.3f ms is used.\n",
+                1000. / _read_clocks[0].getFPS());
+    }
+    else {
+        _read_clocks[0].setFPS(1000. / option.interval);
     }
 
     size_t loop_count = 0;
-    uint8_t idx = 0;
+    uint64_t read_count = 0;
     cv::Mat frame;
     while(!_should_stop) {
-        auto time_start = getCurrentTimePoint();
+        _read_clocks[0].wait();
 
-        bool flag = cap.read(frame);
-        if(!flag) {
-            cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+        // The frame is read straight into a free slot, it is dropped only if the readers
+        // still hold every other slot
+        StereoFrame* slot = _stereo_frames.beginWrite();
+
+        ReadStatus status = source->read(slot ? slot->image : frame);
+        if(status == READ_DROPPED) {
+            _stereo_frames.cancelWrite();
+            continue;
+        }
+        if(status != READ_OK) {
+            _stereo_frames.cancelWrite();
+            source->rewind();
             if(option.is_looped) {
                 printf("VisionViewer: loop displaying count [%ld]\n", ++loop_count);
                 continue;
             }
             else {
                 _should_stop = true;
-                _sem_show.release();
+                _frame_ready.notify();
                 break;
             }
         }
 
-        // Convert color if needed.
-        if(option.is_bgr) {
-            cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
-        }
-
-        idx = tri_frame_prop.getOldestIndex();
-        if(option.is_mono) {
-            _frames[0][idx] = frame.clone();
-        }
-        else {
-            _frames[0][idx] = frame.colRange(0, _imwidth / 2);
-            _frames[1][idx] = frame.colRange(_imwidth / 2, _imwidth);
+        // The color of a swapped video is left to the consumers, the display swaps it
+        // while resizing. Both eyes are views into the slot and go out together, a reader
+        // never sees the halves of two frames.
+        read_count++;
+        if(slot) {
+            slot->split(option.is_mono);
+            _stereo_frames.commitWrite();
+            _frame_ready.notify();
         }
-        _tri_frame_prop[0].update(idx);
-        _tri_frame_prop[1].update(idx);
-        
-        auto delta_ms = option.interval - getDurationSince(time_start);
-#if DO_EFFECIENCY_TEST
-        printf("VisionViewer::readVideoFrame: [%ld]ms elapsed.\n", ms);
-#endif
-        if(delta_ms > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(delta_ms));
+        // A frame the display had no slot for is still recorded
+        if(_should_write) {
+            recordFrame(0, slot ? slot->image : frame, read_count);
         }
-        _sem_show.release();
-        // if(_should_write) {
-        //     _sem_write.release();
-        // }
     }
 }
 
 void VisionViewer::readCameraFrame(bool is_right) {
-    auto initVideoCapture = [](cv::VideoCapture &capture, int cam_id, int w, int h) {
-        capture.open(cam_id);
-        capture.set(cv::CAP_PROP_FOURCC, cv::CAP_OPENCV_MJPEG);
-        capture.set(cv::CAP_PROP_FRAME_WIDTH, w);
-        capture.set(cv::CAP_PROP_FRAME_HEIGHT, h);
-        capture.set(cv::CAP_PROP_BUFFERSIZE, 3);
-        // capture.set(cv::CAP_PROP_SHARPNESS, 3);
-    };
     auto& option = _cam_option;
-    auto& cap = _capture[is_right];
+    auto& source = _source[is_right];
     auto& frames = _frames[is_right];
     auto cam_id = option.index[is_right];
-    auto& tri_frame_prop = _tri_frame_prop[is_right];
+    applyThreadRole(THREAD_CAPTURE, is_right ? "capture-right" : "capture-left");
 
     _imwidth = _cam_option.imwidth;
     _imheight = _cam_option.imheight;
 
-    initVideoCapture(cap, cam_id, _imwidth, _imheight);
+    if(option.backend == CAMERA_REPLAY) {
+        // Named by eye like endo_viewer dumps them, whatever the camera indices were
+        source = createReplaySource(option.replay_prefix + "_" + std::to_string(is_right) 
+                                    + ".v4ldump", option.is_replay_realtime);
+    }
+    else {
+        source = createCameraSource(option.backend, cam_id, _imwidth, _imheight, 
+                                    option.is_latest_only);
+    }
+    if(!source) {
+        _should_stop = true;
+        _frame_ready.notify();
+        return;
+    }
+    printf("VisionViewer::read%sImage: reading from %s.\n", 
+            is_right ? "Right":"Left", source->getName().c_str());
+    // Retry the open shortly while the camera is still enumerating
+    auto time_open = ::getCurrentTimePoint();
+    int retry_ms = 50;
+    bool is_opened = source->open();
+    for(int i = 0; !is_opened && i < 8 && !_should_stop; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms));
+        retry_ms = std::min(retry_ms * 2, 1000);
+        is_opened = source->open();
+    }
+    // The device may run another size than the requested one
+    if(is_opened) {
+        _imwidth = source->getSize().width;
+        _imheight = source->getSize().height;
+        FramePool::getInstance().reserve(size_t(_imwidth) * _imheight * 3, frames.size());
+    }
+    printf("VisionViewer::read%sImage: %s is %s after [%ld]ms.\n", is_right ? "Right":"Left",
+            source->getName().c_str(), is_opened ? "opened" : "not opened", 
+            ::getDurationSince(time_open));
+    bool is_first_frame = true;
 
-    bool flag = 0;
-    uint8_t idx = 0;
+    uint64_t read_count = 0;
+    uint64_t dropped_count = 0;
     cv::Mat frame;
+    // The read blocks until the source has a frame, so the camera sets the pace
+    auto& clock = _read_clocks[is_right];
+    clock.setFPS(source->getFPS());
     while(true) {
-        auto time_start = ::getCurrentTimePoint();
-
-        flag = cap.read(frame);
-        flag = flag && (!frame.empty());
-        if(!flag) {
-            printf("VisionViewer::read%sImage: USB ID: %d, image empty: %d.\n",
-                    is_right ? "Right":"Left", cam_id, frame.empty());
-            cap.release();
-            initVideoCapture(cap, cam_id, _imwidth, _imheight);
-            std::this_thread::sleep_for(std::chrono::seconds(500));
+        // The frame is read straight into a free slot. If the readers hold all of them it
+        // is still read, to keep the camera going, and dropped.
+        cv::Mat* slot = frames.beginWrite();
+        ReadStatus status = source->read(slot ? *slot : frame);
+        // A corrupt frame is only lost, the device is reopened when the capture fails.
+        // A reopened replay would start over and lose the other eye.
+        if(status == READ_DROPPED) {
+            frames.cancelWrite();
+            if(++dropped_count % 100 == 1) {
+                printf("VisionViewer::read%sImage: USB ID: %d, [%lu] corrupt frames dropped.\n",
+                        is_right ? "Right":"Left", cam_id, dropped_count);
+            }
             continue;
         }
-        
-        idx = tri_frame_prop.getOldestIndex();
-        frames[idx] = frame.clone();
-        tri_frame_prop.update(idx);
-
-        auto delta_ms = getDurationSince(time_start) - TIME_INTTERVAL;
-#if DO_EFFECIENCY_TEST
-        printf("BinoViewer::read%sImage: [%ld]ms elapsed.\n", 
-                is_right ? "Right":"Left", ms);
-#endif
-        if(delta_ms > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(delta_ms));
+        if(status != READ_OK) {
+            frames.cancelWrite();
+            printf("VisionViewer::read%sImage: USB ID: %d, capture failed, reopen.\n",
+                    is_right ? "Right":"Left", cam_id);
+            source->release();
+            source->open();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+        if(is_first_frame) {
+            is_first_frame = false;
+            printf("VisionViewer::read%sImage: first frame after [%ld]ms.\n",
+                    is_right ? "Right":"Left", ::getDurationSince(time_open));
+        }
+        frames.commitWrite();
+        _frame_ready.notify();
+        clock.mark();
+        // A frame the display had no slot for is still recorded
+        read_count++;
+        if(_should_write) {
+            recordFrame(is_right, slot ? *slot : frame, read_count);
         }
-        _sem_show.release();
     }
 }
 
@@ -246,54 +411,95 @@ void VisionViewer::show() {
     bool has_2d = _win_names_2d.size() > 0;
     bool has_3d = _win_info_3d.size() > 0;
     bool is_mono = _mode == VIDEO ? _vid_option.is_mono : _cam_option.is_mono;
+    bool is_swap_rb = _mode == VIDEO && _vid_option.is_bgr;
     bool is_show_right = false;
 
-    uint8_t idx = 0;
+    FrameSet frames;
     cv::Mat image, imleft, imright;
+    applyThreadRole(THREAD_DISPLAY, "display");
+    // The preemptions are reported once all the threads run for a while
+    auto time_report = getCurrentTimePoint();
+    bool is_reported = false;
+
+    // The frame time is reported every few seconds, 't' switches the parallel composing
+    // to compare
+    bool is_parallel = true;
+    auto time_telemetry = getCurrentTimePoint();
+    double compose_ms = 0, imshow_ms = 0;
+    uint64_t telemetry_frames = 0;
+    size_t win_count = _win_info_3d.size() + _win_names_2d.size();
     
     while(!_should_stop) {
-        _sem_show.take();
-
-        idx = _tri_frame_prop[0].getNewestIndex();
-        imleft = _frames[0][idx].clone();
-        idx = _tri_frame_prop[1].getNewestIndex();
-        imright = _frames[1][idx].clone();
+        if(!is_reported && getDurationSince(time_report) > 5000) {
+            printThreadReport();
+            is_reported = true;
+        }
+        if(telemetry_frames > 0 && getDurationSince(time_telemetry) > 5000) {
+            printf("VisionViewer: [%zu] windows, [%zu] canvases composed %s, compose [%.2f]ms "
+                   "and imshow [%.2f]ms per frame over [%lu] frames.\n", win_count, 
+                   _render_plans.size(), is_parallel ? "in parallel" : "one by one", 
+                   compose_ms / telemetry_frames, imshow_ms / telemetry_frames, 
+                   telemetry_frames);
+            compose_ms = imshow_ms = 0;
+            telemetry_frames = 0;
+            time_telemetry = getCurrentTimePoint();
+        }
+        // The frames are held, not copied, until the next ones are taken. The timeout
+        // only lets the stop flag be seen.
+        if(!takeNewFrames(frames, 100)) {
+            continue;
+        }
+        imleft = frames.left;
+        imright = frames.right;
 
-        // Display 3D
+        // Display 3D, the canvases are composed first, the GUI calls stay on this thread
+        auto time_compose = getCurrentTimePoint();
+        if(!is_mono && has_3d) {
+            composeRenderPlans(imleft, imright, is_swap_rb, is_parallel);
+        }
+        auto time_imshow = getCurrentTimePoint();
+        compose_ms += getMsSince(time_compose);
         if(!is_mono && has_3d) {
-            for(auto& win_info : _win_info_3d) {
-                int win_width = win_info.win_width;
-                int win_height = win_info.win_height;
-                float scale = 1.f * win_height / _imheight;
-                int new_width = round(_imwidth * scale);
-                int x_half_devia = (win_width - new_width) / 2;;
-                cv::Size cvsize = cv::Size(new_width, win_height);
-
-                // printf("win size:%dx%d, scale:%f, x_half_devia:%d\n",
-                //     win_width, win_height, scale, x_half_devia);
-
-                cv::Mat imbino = cv::Mat(win_height, win_width*2, CV_8UC3, cv::Scalar(0, 0, 0));
-                int start = x_half_devia;
-                cv::resize(imleft, imbino.colRange(start, start + new_width), cvsize);
-                start = x_half_devia + win_width;
-                cv::resize(imright, imbino.colRange(start, start + new_width), cvsize);
-
-                cv::imshow(win_info.win_name, imbino);
+            for(auto& plan : _render_plans) {
+                for(auto& win_name : plan.win_names) {
+                    cv::imshow(win_name, plan.canvas);
+                }
             }
         }
 
         // Display 2D
         if(has_2d) {
-            image = is_show_right ? imright : imleft;
+            if(is_swap_rb) {
+                cv::cvtColor(is_show_right ? imright : imleft, image, cv::COLOR_BGR2RGB);
+            }
+            else {
+                image = is_show_right ? imright : imleft;
+            }
 
             for(auto& win_name : _win_names_2d) {
                 cv::imshow(win_name, image);
             }
         }
+        imshow_ms += getMsSince(time_imshow);
+        telemetry_frames++;
+        _display_clock.mark();
 
-        char key = cv::waitKey(10);
+        // The next frames are waited for above, the window events only need a poll
+        char key = cv::waitKey(1);
         if(key == 'q') {
-            printf("VisionViewer: exit video showing.\n");
+            auto stats = FramePool::getInstance().getStats();
+            printf("VisionViewer: exit video showing, frame pool [%lu] hits, [%lu] misses, "
+                   "[%zu] slabs of [%zu]MB, [%zu] on huge pages, [%lu/%lu] frames dropped.\n",
+                   stats.hits, stats.misses, stats.slabs, stats.bytes >> 20, stats.huge_slabs,
+                   _frames[0].getDropCount() + _stereo_frames.getDropCount(), 
+                   _frames[1].getDropCount());
+            _read_clocks[0].printStats(_mode == VIDEO ? "VisionViewer: read" 
+                                                      : "VisionViewer: left camera");
+            if(_mode == CAMERA && !is_mono) {
+                _read_clocks[1].printStats("VisionViewer: right camera");
+            }
+            _display_clock.printStats("VisionViewer: display");
+            printThreadReport();
             _should_stop = true;
             break;
         }
@@ -302,29 +508,41 @@ void VisionViewer::show() {
                 is_show_right = !is_show_right;
             }
         }
+        else if(key == 't') {
+            is_parallel = !is_parallel;
+            printf("VisionViewer: compose the canvases %s.\n", 
+                   is_parallel ? "in parallel" : "one by one");
+        }
         else if(key == 'p') {
             std::string prefix = getCurrentTimeStr();
+            // The frames are shared with the other consumers, a swap goes to copies
+            cv::Mat snapleft, snapright;
+            if(is_swap_rb) {
+                cv::cvtColor(imleft, snapleft, cv::COLOR_BGR2RGB);
+                if(!is_mono) {
+                    cv::cvtColor(imright, snapright, cv::COLOR_BGR2RGB);
+                }
+            }
+            else {
+                snapleft = imleft;
+                snapright = imright;
+            }
             if(is_mono) {
-                cv::imwrite(prefix + ".bmp", imleft);
+                cv::imwrite(prefix + ".bmp", snapleft);
                 printf("VisionViewer: save mono image %s done.\n", prefix.c_str());
             }
             else {
                 cv::Mat imbino;
-                cv::hconcat(imleft, imright, imbino);
+                cv::hconcat(snapleft, snapright, imbino);
                 cv::imwrite(prefix + ".bmp", imbino);
                 printf("VisionViewer: save bino image %s done.\n", prefix.c_str());
             }            
         }
         else if(key == 's') {
+            // The writer starts or ends the recording
             _should_write = !_should_write;
-            if(!refreshVideoWriter()) {
-                _should_write = false;
-            }
         }
 
-        if(_should_write) {
-            _sem_write.release();
-        }
 
 #if DO_EFFECIENCY_TEST
         printf("VisionViewer::show2D: [%ld]ms elapsed.\n", ms);
@@ -334,55 +552,216 @@ void VisionViewer::show() {
 
 void VisionViewer::writeVideo() {
     bool is_mono = _mode == VIDEO ? _vid_option.is_mono : _cam_option.is_mono;
-    cv::Mat image(_imheight, is_mono ? _imwidth : _imwidth*2, CV_8UC3, cv::Scalar(0, 0, 0));
+    // A video frame is already side by side, the cameras are paired
+    bool is_paired = _mode == CAMERA && !is_mono;
+    auto policy = _mode == VIDEO ? _vid_option.record_policy : _cam_option.record_policy;
+    for(auto& queue : _record_queues) {
+        queue.setPolicy(policy);
+    }
+    cv::Mat image;
+    applyThreadRole(THREAD_WRITER, "writer");
 
     int max_minutes = 5;
-    uint8_t idx = 0;
-    while(true) {
-        _sem_write.take();
-
-        if(is_mono) {
-            idx = _tri_frame_prop[0].getNewestIndex();
-            image = _frames[0][idx].clone();
+    bool is_writing = false;
+    RecordFrame records[2];
+    bool has_record[2] = { false, false };
+    uint64_t unpaired[2] = { 0, 0 };
+
+    // Write the next frame or pair, false if the queues have no more in time
+    auto writeNext = [&](int timeout_ms) {
+        for(int i = 0; i < (is_paired ? 2 : 1); i++) {
+            if(!has_record[i]) {
+                has_record[i] = _record_queues[i].pop(records[i], timeout_ms);
+            }
+        }
+        if(!has_record[0] || (is_paired && !has_record[1])) {
+            return false;
+        }
+        if(is_paired) {
+            // The eyes are paired by the read time, within half a frame
+            int64_t tolerance_us = static_cast<int64_t>(500000 / _record_fps);
+            int64_t skew_us = records[0].timestamp_us - records[1].timestamp_us;
+            if(skew_us > tolerance_us || skew_us < -tolerance_us) {
+                int older = skew_us > 0;
+                has_record[older] = false;
+                unpaired[older]++;
+                return true;
+            }
+            int width = records[0].image.cols;
+            if(records[1].image.size() != records[0].image.size()) {
+                has_record[0] = has_record[1] = false;
+                unpaired[0]++;
+                unpaired[1]++;
+                return true;
+            }
+            image.create(records[0].image.rows, width * 2, records[0].image.type());
+            records[0].image.copyTo(image.colRange(0, width));
+            records[1].image.copyTo(image.colRange(width, 2 * width));
+            _video_writer.write(image);
         }
         else {
-            idx = _tri_frame_prop[0].getNewestIndex();
-            _frames[0][idx].copyTo(image.colRange(0, _imwidth));
-            idx = _tri_frame_prop[1].getNewestIndex();
-            _frames[1][idx].copyTo(image.colRange(_imwidth, 2*_imwidth));
+            _video_writer.write(records[0].image);
+        }
+        if(_timestamp_file) {
+            fprintf(_timestamp_file, "%lu,%lu,%ld", _written_count, records[0].sequence,
+                    records[0].timestamp_us);
+            if(is_paired) {
+                fprintf(_timestamp_file, ",%lu,%ld", records[1].sequence,
+                        records[1].timestamp_us);
+            }
+            fprintf(_timestamp_file, "\n");
         }
-        _video_writer.write(image); 
+        _written_count++;
+        has_record[0] = has_record[1] = false;
+        return true;
+    };
 
-        if(getDurationSince(_write_start) > (max_minutes*60*1000)) {
+    while(true) {
+        // The recording is started and ended here, the display only flips _should_write
+        bool should_write = _should_write && !_should_stop;
+        if(should_write && !is_writing) {
+            for(auto& queue : _record_queues) {
+                queue.open();
+            }
+            unpaired[0] = unpaired[1] = 0;
+            is_writing = refreshVideoWriter();
+            if(!is_writing) {
+                _record_queues[0].close();
+                _record_queues[1].close();
+                _should_write = false;
+            }
+        }
+        else if(!should_write && is_writing) {
+            // The frames queued so far are still written
+            for(auto& queue : _record_queues) {
+                queue.close();
+            }
+            while(writeNext(0)) {}
+            unpaired[0] += has_record[0];
+            unpaired[1] += has_record[1];
+            has_record[0] = has_record[1] = false;
+
+            auto stats_l = _record_queues[0].getStats();
+            auto stats_r = _record_queues[1].getStats();
+            printf("VisionViewer: stop write video, [%lu/%lu] frames captured, [%lu/%lu] "
+                   "enqueued, [%lu/%lu] dropped by the queue, [%lu/%lu] unpaired, at most "
+                   "[%zu/%zu] queued.\n", stats_l.pushed, stats_r.pushed, stats_l.enqueued,
+                   stats_r.enqueued, stats_l.dropped, stats_r.dropped, unpaired[0],
+                   unpaired[1], stats_l.max_size, stats_r.max_size);
             _video_writer.release();
+            if(_timestamp_file) {
+                fclose(_timestamp_file);
+                _timestamp_file = nullptr;
+            }
+            printf("VisionViewer: [%lu] frames written to the last file.\n", _written_count);
+            is_writing = false;
+        }
+
+        if(!is_writing) {
+            if(_should_stop) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(TIME_INTTERVAL));
+            continue;
+        }
+
+        writeNext(100);
+        if(getDurationSince(_write_start) > (max_minutes*60*1000)) {
             printf("VisionViewer: write out video is beyond %d minutes, a new write out "
                 "process is started.\n", max_minutes);
+            // The queues stay open, no frame is lost at the switch
             refreshVideoWriter();
         }
-#if DO_EFFECIENCY_TEST
-        printf("VisionViewer::writeVideo: [%ld]ms elapsed.\n", ms);
-#endif
     }
 }
 
-bool VisionViewer::refreshVideoWriter() {
-    if(_should_write) {
-        bool is_mono = _mode == VIDEO ? _vid_option.is_mono : _cam_option.is_mono;
-        cv::Size size = cv::Size(is_mono ? _imwidth : _imwidth*2, _imheight);
-        std::string video_name = getCurrentTimeStr() + ".avi";
-        _video_writer.open(video_name,  cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 
-                           30, size, true);
-        if (!_video_writer.isOpened()) {
-            std::cout << "VisionViewer: cannot open the video writer, writer thread stop!\n";
-            return false;
+bool VisionViewer::takeNewFrames(FrameSet& frames, int timeout_ms) {
+    bool is_mono = _mode == VIDEO ? _vid_option.is_mono : _cam_option.is_mono;
+    bool is_new = _frame_ready.waitUntil([&]() {
+        if(_should_stop) {
+            return true;
         }
-        _write_start = ::getCurrentTimePoint();
-        printf("VisionViewer: start write video to %s, with image size: %dx%d.\n", 
-            video_name.c_str(), size.width, size.height);
+        if(_mode == VIDEO) {
+            return _stereo_frames.getNewestSequence() > frames.sequence[0];
+        }
+        return _frames[0].getNewestSequence() > frames.sequence[0] 
+               && (is_mono || _frames[1].getNewestSequence() > frames.sequence[1]);
+    }, timeout_ms);
+    if(!is_new || _should_stop) {
+        return false;
+    }
+
+    if(_mode == VIDEO) {
+        frames.stereo = _stereo_frames.readNewest();
+        frames.sequence[0] = frames.stereo.getSequence();
+        frames.left = frames.stereo ? frames.stereo->eye[0] : cv::Mat();
+        frames.right = frames.stereo ? frames.stereo->eye[1] : cv::Mat();
     }
     else {
-        _video_writer.release();
-        printf("VisionViewer: stop write video.\n");
+        for(int i = 0; i < 2; i++) {
+            frames.eye[i] = _frames[i].readNewest();
+            frames.sequence[i] = frames.eye[i].getSequence();
+        }
+        frames.left = frames.eye[0] ? *frames.eye[0] : cv::Mat();
+        frames.right = frames.eye[1] ? *frames.eye[1] : cv::Mat();
     }
     return true;
-}
\ No newline at end of file
+}
+
+void VisionViewer::applyThreadRole(ThreadRole role, const std::string& name) {
+    applyThreadConfig(_mode == VIDEO ? _vid_option.threads : _cam_option.threads, role, name);
+}
+
+void VisionViewer::recordFrame(int index, const cv::Mat& image, uint64_t sequence) {
+    RecordFrame record;
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.sequence = sequence;
+    // The frame buffers are reused by the readers, so the recording takes a copy, with the
+    // color of a swapped video converted on the way
+    if(_mode == VIDEO && _vid_option.is_bgr) {
+        cv::cvtColor(image, record.image, cv::COLOR_BGR2RGB);
+    }
+    else {
+        image.copyTo(record.image);
+    }
+    _record_queues[index].push(std::move(record));
+}
+
+bool VisionViewer::refreshVideoWriter() {
+    // The file runs at the rate the frames are read, every one of them is written
+    if(_mode == VIDEO && _vid_option.interval > 0) {
+        _record_fps = 1000.0 / _vid_option.interval;
+    }
+    else if(_source[0] && _source[0]->getFPS() > 0) {
+        _record_fps = _source[0]->getFPS();
+    }
+
+    // A video frame is already side by side, the cameras are put next to each other
+    bool is_mono = _mode == VIDEO || _cam_option.is_mono;
+    cv::Size size = cv::Size(is_mono ? _imwidth : _imwidth*2, _imheight);
+    std::string prefix = getCurrentTimeStr();
+    std::string video_name = prefix + ".avi";
+    _video_writer.release();
+    _video_writer.open(video_name,  cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 
+                       _record_fps, size, true);
+    if (!_video_writer.isOpened()) {
+        std::cout << "VisionViewer: cannot open the video writer, writer thread stop!\n";
+        return false;
+    }
+
+    // One line for each frame written, with the sequence and the read time of each eye
+    if(_timestamp_file) {
+        fclose(_timestamp_file);
+    }
+    _timestamp_file = fopen((prefix + ".csv").c_str(), "w");
+    if(_timestamp_file) {
+        fprintf(_timestamp_file, is_mono ? "frame,sequence,timestamp_us\n"
+            : "frame,left_sequence,left_timestamp_us,right_sequence,right_timestamp_us\n");
+    }
+    _written_count = 0;
+    _write_start = ::getCurrentTimePoint();
+    printf("VisionViewer: start write video to %s, with image size: %dx%d at %.2f FPS.\n", 
+        video_name.c_str(), size.width, size.height, _record_fps);
+    return true;
+}
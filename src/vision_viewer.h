@@ -11,13 +11,20 @@
 #ifndef H_WLF_D574CEFC_5F34_4383_A1E9_C2720631993D
 #define H_WLF_D574CEFC_5F34_4383_A1E9_C2720631993D
 #include <cstdint>
+#include <cstdio>
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
 #include <chrono>
-#include "./define/triple_buffer.h"
+#include <memory>
+#include "./define/frame_ring.h"
+#include "./define/stereo_frame.h"
 #include "./define/vision_options.h"
-#include "./define/csemaphore.h"
+#include "./define/frame_signal.h"
+#include "./define/record_queue.h"
+#include "./define/frame_clock.h"
+#include "./define/resize_convert.h"
+#include "./source/frame_source.h"
 
 /**
  * @brief A class for viewing monocular or binocular video, based on OpenCV.
@@ -63,11 +70,43 @@ private:
         bool        is_hcompress;   ///< Has h-compress in 3D display.
     };
 
+    /**
+     * @brief How the eyes are put on the 3D windows of one geometry, worked out once for an
+     * eye size and reused for every frame.
+     */
+    struct RenderPlan {
+        uint16_t    win_width;      ///< The window width.
+        uint16_t    win_height;     ///< The window height.
+        bool        is_hcompress;   ///< Has h-compress in 3D display.
+        std::vector<std::string> win_names; ///< The windows showing the canvas.
+
+        cv::Size    eye_size;       ///< The eye size planned for, empty before the first frame.
+        cv::Size    dst_size;       ///< The size of each eye on the canvas.
+        int         interpolation;  ///< The resize interpolation for the scale.
+        cv::Mat     canvas;         ///< Both eyes side by side, the bars painted once.
+        cv::Mat     dst[2];         ///< The regions of the left and the right eye in canvas.
+        ResizeConvertPlan convert_plan; ///< The taps of a swapped eye, shared by both eyes.
+    };
+
     /**
      * @brief Parse the display information.
      */
     void parseDisplayInfo();
 
+    /**
+     * @brief Plan the regions, the interpolation and the canvas for the eye size.
+     */
+    void updateRenderPlan(RenderPlan& plan, const cv::Size& eye_size);
+
+    /**
+     * @brief Put the eyes on the canvases of all the render plans.
+     *
+     * @param is_swap_rb Swap the red and the blue channels of the eyes on the way.
+     * @param is_parallel Compose the canvases on all the cores, if there are several.
+     */
+    void composeRenderPlans(const cv::Mat& imleft, const cv::Mat& imright, bool is_swap_rb,
+                            bool is_parallel);
+
     /**
      * @brief Do frame rading.
      */
@@ -89,10 +128,54 @@ private:
     void writeVideo();
 
     /**
-     * @brief Refresh video writer.
+     * @brief Open a new video file and its timestamps, the current ones are closed.
      */
     bool refreshVideoWriter();
 
+    /**
+     * @brief A frame queued for the recording.
+     */
+    struct RecordFrame {
+        cv::Mat  image;
+        uint64_t sequence;      ///< The count of the frames read from its source.
+        int64_t  timestamp_us;  ///< The time it was read, on the steady clock.
+    };
+
+    /**
+     * @brief Queue a copy of a frame just read for the writer, while recording.
+     *
+     * @param index 0 for the left or the only source, 1 for the right one.
+     */
+    void recordFrame(int index, const cv::Mat& image, uint64_t sequence);
+
+    /**
+     * @brief The frames a consumer took, held until it takes the next ones.
+     */
+    struct FrameSet {
+        FrameRing<StereoFrame, 4>::Handle stereo;   ///< The frame of a video.
+        FrameRing<cv::Mat, 4>::Handle     eye[2];   ///< The frames of the cameras.
+        cv::Mat  left;          ///< The left or mono view.
+        cv::Mat  right;         ///< The right view, empty for mono.
+        uint64_t sequence[2];   ///< The sequences taken, only the first one for a video.
+
+        FrameSet() : sequence{0, 0} {}
+    };
+
+    /**
+     * @brief Wait until every eye has a frame newer than the taken ones and take them,
+     * once for a pair.
+     *
+     * @param frames The frames taken last, replaced by the new ones.
+     * @param timeout_ms Give up after this time.
+     * @return false on timeout or stop.
+     */
+    bool takeNewFrames(FrameSet& frames, int timeout_ms);
+
+    /**
+     * @brief Apply the configured cores and scheduling of the role to the calling thread.
+     */
+    void applyThreadRole(ThreadRole role, const std::string& name);
+
 private:
     /**
      * @brief Specify the running mode.
@@ -108,18 +191,34 @@ private:
 
     std::vector<std::string> _win_names_2d; ///< The necessary information for 2D display.
     std::vector<cvWinInfo>   _win_info_3d;  ///< The necessary information for 3D display.
+    std::vector<RenderPlan>  _render_plans; ///< One for each 3D window geometry.
 
-    cv::VideoCapture _capture[2];       ///< OpenCV capture for camera or video capture.
+    std::unique_ptr<FrameSource> _source[2];    ///< The video or the cameras read from.
     volatile bool    _should_stop;      ///< Flag for controlling stop.
     cv::VideoWriter  _video_writer;     ///< For video write out.
     volatile bool    _should_write;     ///< Flag for write out video.
     std::chrono::steady_clock::time_point _write_start;   ///< The start write time.
+    FILE*            _timestamp_file;   ///< The timestamps of the frames written.
+    uint64_t         _written_count;    ///< The frames written to the current file.
+    double           _record_fps;       ///< The frame rate the files are written at.
+
+    /**
+     * @brief Every frame read while recording, from each reader to the writer.
+     */
+    RecordQueue<RecordFrame> _record_queues[2];
 
-    CSemaphore _sem_show;                     ///< Semaphore for control display.
-    CSemaphore _sem_write;                    ///< Semaphore for control write out.
+    FrameSignal _frame_ready;           ///< Notified by the readers for each new frame.
+    FrameClock  _read_clocks[2];        ///< Paces the video, marks the frames of the cameras.
+    FrameClock  _display_clock;         ///< Marks the frames shown.
 
-    TripleBuffer<uint8_t> _tri_frame_prop[2]; ///< For read frames.
-    cv::Mat _frames[2][3];                    ///< For store frames.
+    /**
+     * @brief The frames, read in place by show() and writeVideo() without a copy.
+     *
+     * One slot for each of the two readers, one published and one being read into. Both
+     * eyes of a video are published together, each camera publishes its own.
+     */
+    FrameRing<StereoFrame, 4> _stereo_frames;
+    FrameRing<cv::Mat, 4>     _frames[2];
 
 };
 
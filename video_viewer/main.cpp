@@ -16,8 +16,10 @@ int main(int argc, char* argv[])
            "\t\t -l\tSpecify the given video will be looped display (defaultly)\n"
            "\t\t -b\tSpecify the given video is BGR format (RGB is default)\n"
            "\t\t -t [value]\tSpecify the image refresh interval is [value] ms\n"
+           "\t\t -q [policy]\tWhen the recording lags: block (default), oldest or newest to drop.\n"
            );
     printScreenArgDesc();
+    printThreadArgDesc();
     printf("-------------------------------------------------------------------------\n");
     printf("                           VideoViewer Startup \n");
     printf("-------------------------------------------------------------------------\n");
@@ -32,7 +34,7 @@ int main(int argc, char* argv[])
     option.screens.clear();
 
     int opt;
-    std::string optstring = "mlbt:n:";
+    std::string optstring = "mlbt:n:a:q:";
     while((opt = getopt(argc, argv, optstring.c_str())) != -1) {
         switch (opt)
         {
@@ -60,6 +62,21 @@ int main(int argc, char* argv[])
                 throw std::invalid_argument(err.str());
             }
             break;
+        case 'q':
+            if(!parseRecordPolicy(optarg, option.record_policy)) {
+                std::ostringstream err;
+                err << "VideoViewer: invalid record policy is given: " << optarg << std::endl;
+                throw std::invalid_argument(err.str());
+            }
+            printf("VideoViewer: specify record policy to %s.\n", optarg);
+            break;
+        case 'a':
+            if(!parseThreadConfig(optarg, option.threads)) {
+                std::ostringstream err;
+                err << "VideoViewer: invalid thread config is given: " << optarg << std::endl;
+                throw std::invalid_argument(err.str());
+            }
+            break;
         default:
             break;
         }